@@ -0,0 +1,157 @@
+///*******************************************
+///@file binaryProtocol.cpp
+///@brief Binary command protocol for hosts, next to the ASCII commands for humans.
+///*******************************************
+
+#include "binaryProtocol.h"
+#include "serialOut.h"
+
+BinaryProtocol binary_protocol;
+
+uint8_t binaryFieldSize(uint8_t id) {
+	switch (id) {
+		case BINARY_AUTO_MODE:
+		case BINARY_EXTERNAL_TRIGGER_MODE:
+		case BINARY_SUB_TRIGGER_INTERLEAVED:
+		case BINARY_POWER_ON:
+		case BINARY_CAMERA_WORKS:
+		case BINARY_ERROR_LED:
+		case BINARY_FAN:
+		case BINARY_PROPAGATION_MODE:
+		case BINARY_DAISY_CHAIN_LOCKED:
+		case BINARY_DAISY_CHAIN_NODE:
+		case BINARY_TELEMETRY_ON:
+		case BINARY_CHAIN_NODES:
+		case BINARY_DAISY_CHAIN_RING:
+			return 1;
+		case BINARY_NO_OF_STROBES:
+		case BINARY_DAISY_CHAIN_HOP_LATENCY_US:
+		case BINARY_VERSION:
+		case BINARY_CHAIN_STATUS:
+			return 2;
+		case BINARY_FULL_CYCLE_LEN_US:
+		case BINARY_LIGHT_PULSE_DUTY_LEN_US:
+		case BINARY_LIGHTS_PULSE_LEN_US:
+		case BINARY_ENCODER_COUNTS_PER_IMAGE:
+		case BINARY_PHASE_OFFSET_US:
+		case BINARY_MIN_TRIGGER_INTERVAL_US:
+		case BINARY_IMAGE_PERIOD_US:
+		case BINARY_PULSE_PERIOD_US:
+		case BINARY_PULSE_DUTY_US:
+		case BINARY_CAMERA_EXPOSURE_US:
+		case BINARY_EXTERNAL_TRIGGER_PERIOD_US:
+			return 4;
+		case BINARY_TRIGGER_PLAN:
+			return 8;
+		case BINARY_SUB_TRIGGER0:
+		case BINARY_SUB_TRIGGER1:
+		case BINARY_SUB_TRIGGER2:
+			return 11;
+		default:
+			return 0;
+	}
+}
+
+unsigned long binaryValue(const uint8_t* data, uint8_t size) {
+	unsigned long value = 0;
+	for (uint8_t i = size; i > 0; i--)
+		value = (value << 8) | data[i-1];
+	return value;
+}
+
+uint16_t binaryFrameCrc(uint16_t crc, uint8_t data) {
+	crc ^= (uint16_t)data << 8;
+	for (uint8_t b = 0; b < 8; b++)
+		crc = (crc & 0x8000)?((crc << 1) ^ 0x1021):(crc << 1);
+	return crc;
+}
+
+BinaryProtocol::BinaryProtocol() {
+	dropped_frames_ = 0;
+	reply_crc_ = 0xFFFF;
+	reset();
+}
+
+void BinaryProtocol::reset() {
+	len_ = 0;
+	receiving_ = false;
+	escaped_ = false;
+	overflow_ = false;
+}
+
+bool BinaryProtocol::receive(uint8_t data) {
+	if (data == BINARY_FRAME_END) {
+		if (!receiving_ || ((len_ == 0) && !overflow_)) {
+			// start of a frame, or an empty frame between two ENDs
+			reset();
+			receiving_ = true;
+			return false;
+		}
+		bool valid = !overflow_ && !escaped_ && (len_ > 2);
+		if (valid) {
+			uint16_t crc = 0xFFFF;
+			for (uint8_t i = 0; i < len_ - 2; i++)
+				crc = binaryFrameCrc(crc, buffer_[i]);
+			valid = (crc == (buffer_[len_-2] | (buffer_[len_-1] << 8)));
+		}
+		if (!valid)
+			dropped_frames_++;
+		uint8_t len = len_;
+		reset();
+		len_ = len;
+		return valid;
+	}
+
+	if (escaped_) {
+		escaped_ = false;
+		if (data == BINARY_FRAME_ESC_END)
+			data = BINARY_FRAME_END;
+		else if (data == BINARY_FRAME_ESC_ESC)
+			data = BINARY_FRAME_ESC;
+	} else if (data == BINARY_FRAME_ESC) {
+		escaped_ = true;
+		return false;
+	}
+
+	if (len_ < BINARY_MAX_FRAME_LEN)
+		buffer_[len_++] = data;
+	else
+		overflow_ = true;
+	return false;
+}
+
+void BinaryProtocol::writeEscaped(uint8_t data) {
+	if (data == BINARY_FRAME_END) {
+		serial_out.write(BINARY_FRAME_ESC);
+		serial_out.write(BINARY_FRAME_ESC_END);
+	} else if (data == BINARY_FRAME_ESC) {
+		serial_out.write(BINARY_FRAME_ESC);
+		serial_out.write(BINARY_FRAME_ESC_ESC);
+	} else
+		serial_out.write(data);
+}
+
+void BinaryProtocol::beginReply(uint8_t type) {
+	serial_out.write(BINARY_FRAME_END);
+	reply_crc_ = 0xFFFF;
+	write(type);
+}
+
+void BinaryProtocol::write(uint8_t data) {
+	reply_crc_ = binaryFrameCrc(reply_crc_, data);
+	writeEscaped(data);
+}
+
+void BinaryProtocol::writeValue(unsigned long value, uint8_t size) {
+	for (uint8_t i = 0; i < size; i++) {
+		write(value);
+		value >>= 8;
+	}
+}
+
+void BinaryProtocol::endReply() {
+	uint16_t crc = reply_crc_;
+	writeEscaped(crc);
+	writeEscaped(crc >> 8);
+	serial_out.write(BINARY_FRAME_END);
+}
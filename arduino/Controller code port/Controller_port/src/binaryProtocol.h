@@ -0,0 +1,145 @@
+///*******************************************
+///@file binaryProtocol.h
+///@brief Binary command protocol for hosts, next to the ASCII commands for humans.
+///      A frame is SLIP framed (RFC 1055): it starts and ends with BINARY_FRAME_END, and
+///      END or ESC within the frame are escaped. END never appears in an ASCII command, so the
+///      first END switches the serial interface to binary until the frame is complete.
+///      The frame is a type, the payload and a CRC-16/CCITT-FALSE (little endian) over both.
+///      BINARY_GET: payload is a list of field ids, the reply returns id and value of each.
+///      BINARY_SET: payload is a list of id and value, applied one after the other.
+///      BINARY_SET_STAGED: like BINARY_SET, but only configuration fields. They are checked together
+///      and take effect at the next cycle boundary all at once, like the S command.
+///      The reply has the type of the request | BINARY_REPLY, followed by the error code (0 is OK).
+///      If a field is rejected, the error is followed by its id, and the fields after it are
+///      neither set nor returned. Values are little endian with the size of binaryFieldSize().
+///      A frame of an unknown type is answered by BINARY_UNKNOWN_TYPE with ErrorUnknownCommand
+///      and the type of the frame.
+///      Frames with a bad CRC or too long are dropped without reply. ASCII output of the controller,
+///      like an asynchronous error, may come before a reply, the host drops it like a bad frame.
+///      With BINARY_TELEMETRY_ON set, the controller sends a BINARY_TELEMETRY frame after every
+///      camera cycle without being asked. A gap in its cycle number means frames got lost.
+///*******************************************
+
+#ifndef BINARY_PROTOCOL_H
+#define BINARY_PROTOCOL_H
+
+#include <Arduino.h>
+
+constexpr uint8_t BINARY_FRAME_END = 0xC0;
+constexpr uint8_t BINARY_FRAME_ESC = 0xDB;
+constexpr uint8_t BINARY_FRAME_ESC_END = 0xDC;		// END within the frame is sent as ESC ESC_END
+constexpr uint8_t BINARY_FRAME_ESC_ESC = 0xDD;		// ESC within the frame is sent as ESC ESC_ESC
+constexpr uint8_t BINARY_MAX_FRAME_LEN = 96;		// bytes of a received frame including type and CRC
+
+constexpr uint8_t BINARY_GET = 1;
+constexpr uint8_t BINARY_SET = 2;
+constexpr uint8_t BINARY_SET_STAGED = 4;
+constexpr uint8_t BINARY_REPLY = 0x80;
+constexpr uint8_t BINARY_UNKNOWN_TYPE = 0xFF;	// reply to a frame of unknown type, whatever its type is
+
+// sent by the controller, payload is
+//	u32 number of the camera cycle since start
+//	u32 [us] time the camera trigger went out, in the controller's time base
+//	u32 [us] exposure measured with STROBE_OUT, 0 if the camera did not take an image
+//	u16 [us] period and u16 [us] duty of the light pulses, averages of the times they went out
+//	u16 BINARY_TELEMETRY_* flags
+constexpr uint8_t BINARY_TELEMETRY = 3;
+constexpr uint8_t BINARY_TELEMETRY_IMAGE_TAKEN = 0x01;		// the camera took the image of the cycle
+constexpr uint8_t BINARY_TELEMETRY_POWER_ON = 0x02;
+constexpr uint8_t BINARY_TELEMETRY_ERROR_LED = 0x04;
+constexpr uint8_t BINARY_TELEMETRY_LOCKED = 0x08;			// locked to the leader of the daisy chain
+constexpr uint8_t BINARY_TELEMETRY_HOLDOVER = 0x10;			// the leader of the daisy chain got lost
+constexpr uint8_t BINARY_TELEMETRY_EDGES_LOST = 0x20;		// STROBE_OUT edges lost since the last frame
+constexpr uint8_t BINARY_TELEMETRY_OVERRUN = 0x40;			// scheduler tasks overran their budget since the last frame
+constexpr uint8_t BINARY_TELEMETRY_STALL = 0x80;			// serial output waited for the UART since the last frame
+
+// ids of the fields. These numeric values must stay the same for backward compatibility
+enum BinaryField {
+	// configuration
+	BINARY_FULL_CYCLE_LEN_US = 1,			// u32 [us], set takes effect at the next cycle
+	BINARY_LIGHT_PULSE_DUTY_LEN_US = 2,		// u32 [us], set takes effect at the next cycle
+	BINARY_LIGHTS_PULSE_LEN_US = 3,			// u32 [us], read only
+	BINARY_NO_OF_STROBES = 4,				// u16, read only
+	BINARY_AUTO_MODE = 5,					// u8 0/1
+	BINARY_EXTERNAL_TRIGGER_MODE = 6,		// u8 0/1
+	BINARY_ENCODER_COUNTS_PER_IMAGE = 7,	// u32, 0 is off
+	BINARY_DAISY_CHAIN_HOP_LATENCY_US = 8,	// u16 [us]
+	BINARY_PHASE_OFFSET_US = 9,				// u32 [us]
+	BINARY_TRIGGER_PLAN = 10,				// u16 pulses, u32 [us] spacing, u16 pulses before the trigger
+	BINARY_MIN_TRIGGER_INTERVAL_US = 11,	// u32 [us]
+	BINARY_SUB_TRIGGER0 = 12,				// u8 pin (0 off), u8 multiplier, u8 divider, u32 [us] length, u32 [us] offset
+	BINARY_SUB_TRIGGER1 = 13,
+	BINARY_SUB_TRIGGER2 = 14,
+	BINARY_SUB_TRIGGER_INTERLEAVED = 15,	// u8 0/1
+	// status
+	BINARY_VERSION = 0x40,					// u16, read only
+	BINARY_POWER_ON = 0x41,					// u8 0/1, set takes effect at the next cycle
+	BINARY_CAMERA_WORKS = 0x42,				// u8 0/1, read only
+	BINARY_ERROR_LED = 0x43,				// u8 0/1
+	BINARY_FAN = 0x44,						// u8 0/1
+	BINARY_PROPAGATION_MODE = 0x45,			// u8
+	BINARY_IMAGE_PERIOD_US = 0x46,			// u32 [us] measured, read only
+	BINARY_PULSE_PERIOD_US = 0x47,			// u32 [us] measured, read only
+	BINARY_PULSE_DUTY_US = 0x48,			// u32 [us] measured, read only
+	BINARY_CAMERA_EXPOSURE_US = 0x49,		// u32 [us] average, read only
+	BINARY_DAISY_CHAIN_LOCKED = 0x4A,		// u8 0/1, read only
+	BINARY_DAISY_CHAIN_NODE = 0x4B,			// u8, read only
+	BINARY_CHAIN_STATUS = 0x4C,				// u16 DAISY_NODE_* of the nodes up to this one, of all on the head of a ring, read only
+	BINARY_EXTERNAL_TRIGGER_PERIOD_US = 0x4D,	// u32 [us] 0 if unknown, read only
+	BINARY_TELEMETRY_ON = 0x4E,				// u8 0/1, BINARY_TELEMETRY frames after every camera cycle, not stored
+	BINARY_CHAIN_NODES = 0x4F,				// u8 number of nodes of BINARY_CHAIN_STATUS, read only
+	BINARY_DAISY_CHAIN_RING = 0x50			// u8 0/1, head of a ring, the last node's OUT0..2 are wired back to IN0..2
+};
+
+/// @brief bytes of the value of a field, 0 if the field is unknown
+uint8_t binaryFieldSize(uint8_t id);
+
+/// @brief little endian value of size bytes
+unsigned long binaryValue(const uint8_t* data, uint8_t size);
+
+/// @brief CRC-16/CCITT-FALSE, polynomial 0x1021, initial value 0xFFFF
+uint16_t binaryFrameCrc(uint16_t crc, uint8_t data);
+
+class BinaryProtocol
+{
+	public:
+	BinaryProtocol();
+
+	/// @brief drop a partly received frame
+	void reset();
+
+	/// @brief called with every received byte while receiving() or if it is BINARY_FRAME_END.
+	///			Returns true once a complete frame with a valid CRC is in frame()
+	bool receive(uint8_t data);
+
+	/// @brief true between the first END and the end of the frame
+	inline bool receiving() const { return receiving_; }
+
+	/// @brief type and payload of the received frame, without CRC
+	inline const uint8_t* frame() const { return buffer_; }
+	inline uint8_t frameLength() const { return len_ - 2; }
+
+	/// @brief number of frames dropped because of their CRC or length since start
+	inline uint16_t droppedFrames() const { return dropped_frames_; }
+
+	/// @brief a reply or telemetry frame is sent byte by byte, without buffer
+	void beginReply(uint8_t type);
+	void write(uint8_t data);
+	void writeValue(unsigned long value, uint8_t size);
+	void endReply();
+
+	private:
+	void writeEscaped(uint8_t data);
+
+	uint8_t buffer_[BINARY_MAX_FRAME_LEN];
+	uint8_t len_;
+	bool receiving_;
+	bool escaped_;							// last byte was ESC
+	bool overflow_;							// frame is too long and dropped at its end
+	uint16_t dropped_frames_;
+	uint16_t reply_crc_;
+};
+
+extern BinaryProtocol binary_protocol;
+
+#endif // BINARY_PROTOCOL_H
@@ -0,0 +1,75 @@
+///*******************************************
+///@file commandLine.cpp
+///@brief ASCII command being keyed in, in a buffer of fixed size instead of a String.
+///*******************************************
+
+#include <limits.h>
+#include "commandLine.h"
+
+// parses the digits at text into value, returns the character after them or nullptr if
+// there are none or the number does not fit
+static const char* parseDigits(const char* text, unsigned long& value) {
+	const char* ch = text;
+	value = 0;
+	while ((*ch >= '0') && (*ch <= '9')) {
+		if (value > (ULONG_MAX - 9)/10)
+			return nullptr;
+		value = value*10 + (*ch - '0');
+		ch++;
+	}
+	return (ch == text)?nullptr:ch;
+}
+
+char* CommandLine::nextPart(char separator) {
+	if (next_ >= len_)
+		return nullptr;
+	char* part = text_ + next_;
+	while ((next_ < len_) && (text_[next_] != separator))
+		next_++;
+	text_[next_++] = 0;
+	return part;
+}
+
+unsigned long parseNumber(const char* text) {
+	unsigned long value;
+	const char* end = parseDigits(text, value);
+	return ((end != nullptr) && (*end == 0))?value:ULONG_MAX;
+}
+
+unsigned long parseMilli(const char* text) {
+	unsigned long value = 0;
+	int8_t decimals = -1;
+	for (const char* ch = text; *ch != 0; ch++) {
+		if ((*ch == '.') && (decimals < 0))
+			decimals = 0;
+		else if ((*ch >= '0') && (*ch <= '9') && (decimals < 3) && (value < 100000000UL)) {
+			value = value*10 + (*ch - '0');
+			if (decimals >= 0)
+				decimals++;
+		}
+		else
+			return 0;
+	}
+	for (int8_t d = (decimals < 0)?0:decimals; d < 3; d++) {
+		// like f4294968, that would wrap to 704
+		if (value > ULONG_MAX/10)
+			return 0;
+		value *= 10;
+	}
+	return value;
+}
+
+bool parseList(const char* text, unsigned long values[], uint8_t n) {
+	const char* ch = text;
+	for (uint8_t i = 0; i < n; i++) {
+		if (i > 0) {
+			if (*ch != ',')
+				return false;
+			ch++;
+		}
+		ch = parseDigits(ch, values[i]);
+		if (ch == nullptr)
+			return false;
+	}
+	return *ch == 0;
+}
@@ -0,0 +1,72 @@
+///*******************************************
+///@file commandLine.h
+///@brief ASCII command being keyed in, in a buffer of fixed size instead of a String, so parsing
+///      commands does not use the heap. Characters beyond the size mark the command as too long,
+///      it is rejected with its <CR>. The parse functions read the numbers right out of the
+///      buffer without copying them.
+///*******************************************
+
+#ifndef COMMAND_LINE_H
+#define COMMAND_LINE_H
+
+#include <Arduino.h>
+
+constexpr uint8_t COMMAND_LINE_LEN = 64;		// max characters of a command without <CR>, S takes several
+
+class CommandLine
+{
+	public:
+	CommandLine() { clear(); }
+
+	inline void clear() {
+		len_ = 0;
+		text_[0] = 0;
+		overflow_ = false;
+		next_ = 1;
+	}
+
+	inline void add(char ch) {
+		if (len_ < COMMAND_LINE_LEN) {
+			text_[len_++] = ch;
+			text_[len_] = 0;
+		} else
+			overflow_ = true;
+	}
+
+	inline bool empty() const { return len_ == 0; }
+	inline uint8_t length() const { return len_; }
+
+	/// @brief true if characters got lost since the command did not fit
+	inline bool overflow() const { return overflow_; }
+
+	/// @brief letter of the command, 0 if empty
+	inline char letter() const { return text_[0]; }
+
+	/// @brief 0-terminated parameters after the letter
+	inline const char* parameters() const { return text_ + ((len_ > 0)?1:0); }
+
+	/// @brief splits the parameters at separator in place and returns the next part, 0-terminated,
+	///			or nullptr after the last one. Like "f7.5;l1200;" gives "f7.5" and "l1200", a separator
+	///			at the end does not give an empty part
+	char* nextPart(char separator);
+
+	private:
+	char text_[COMMAND_LINE_LEN+1];
+	uint8_t len_;
+	bool overflow_;
+	uint8_t next_;								// start of the next part of nextPart()
+};
+
+/// @brief parses a decimal number like "1200". Returns ULONG_MAX if it is not a number,
+///			which is out of the range of all commands
+unsigned long parseNumber(const char* text);
+
+/// @brief parses a decimal number with up to three digits after the point, like "7.5", into
+///			thousandths. Returns 0 if it is not a number or the thousandths do not fit into 32 bit
+unsigned long parseMilli(const char* text);
+
+/// @brief parses a list of n numbers separated by commas, like "1,13,10,1,1200,0".
+///			Returns false if the list has more or less numbers
+bool parseList(const char* text, unsigned long values[], uint8_t n);
+
+#endif // COMMAND_LINE_H
@@ -37,10 +37,17 @@ enum StrobingControllerError {
   CannotBurnWhileConnected = 13,
   AVRDUDECallFailed = 14,
   HexFileNotFound = 15,
-  Unknown = 16
+  Unknown = 16,
+  // Error codes of the controller added later
+  ErrorDaisyChainNoEcho = 17,
+  ErrorPhaseOffsetOutOfRange = 18,
+  ErrorDaisyChainLeaderLost = 19,
+  ErrorSubTriggerBad = 20,
+  ErrorSubTriggerOverlap = 21,
+  ErrorBinaryFieldBad = 22
 };
 
-constexpr int CTRL_ERROR_ENUM_MAX = 17;
+constexpr int CTRL_ERROR_ENUM_MAX = 23;
 
 // Do not build the following for arduino environment
 #ifndef ARDUINO
@@ -66,7 +73,13 @@ static const std::vector<std::pair<StrobingControllerError, std::string>> Contro
   { CannotBurnWhileConnected, "Cannot Burn While Connected" },
   { AVRDUDECallFailed, "AVRDUDE Call Failed" },
   { HexFileNotFound, "Hex File Not Found" },
-  { Unknown, "Unknown Error" }
+  { Unknown, "Unknown Error" },
+  { ErrorDaisyChainNoEcho, "Daisy Chain No Echo" },
+  { ErrorPhaseOffsetOutOfRange, "Phase Offset Out of Range" },
+  { ErrorDaisyChainLeaderLost, "Daisy Chain Leader Lost" },
+  { ErrorSubTriggerBad, "Bad Sub-Trigger" },
+  { ErrorSubTriggerOverlap, "Sub-Trigger Overlaps Lights" },
+  { ErrorBinaryFieldBad, "Binary Field Unknown, Read Only or Truncated" }
 };
 
 static std::string state_str(bool b) { return b ? "true" : "false"; }
@@ -0,0 +1,58 @@
+///*******************************************
+///@file daisyFrame.cpp
+///@brief Frame carrying the configuration of a leader to its follower over the daisy chain.
+///*******************************************
+
+#include "daisyFrame.h"
+
+uint8_t daisyFrameCrc(const uint8_t* data, uint8_t len) {
+	uint8_t crc = 0;
+	for (uint8_t i = 0; i < len; i++) {
+		crc ^= data[i];
+		for (uint8_t b = 0; b < 8; b++)
+			crc = (crc & 0x80)?((crc << 1) ^ 0x07):(crc << 1);
+	}
+	return crc;
+}
+
+void daisyFrameEncode(const daisy_frame& frame, uint8_t bytes[DAISY_FRAME_BYTES]) {
+	bytes[0] = frame.full_cycle_len_us;
+	bytes[1] = frame.full_cycle_len_us >> 8;
+	bytes[2] = frame.full_cycle_len_us >> 16;
+	bytes[3] = frame.light_pulse_duty_len_us;
+	bytes[4] = frame.light_pulse_duty_len_us >> 8;
+	bytes[5] = frame.flags;
+	bytes[6] = frame.node;
+	bytes[7] = frame.status;
+	bytes[8] = frame.status >> 8;
+	bytes[9] = daisyFrameCrc(bytes, DAISY_FRAME_BYTES-1);
+}
+
+DaisyFrameReceiver::DaisyFrameReceiver() {
+	bits_ = 0;
+	complete_ = false;
+	crc_errors_ = 0;
+}
+
+bool DaisyFrameReceiver::pop(daisy_frame& frame) {
+	if (!complete_)
+		return false;
+	uint8_t bytes[DAISY_FRAME_BYTES];
+	uint8_t sreg = SREG;
+	cli();
+	for (uint8_t i = 0; i < DAISY_FRAME_BYTES; i++)
+		bytes[i] = buffer_[i];
+	complete_ = false;
+	SREG = sreg;
+
+	if (daisyFrameCrc(bytes, DAISY_FRAME_BYTES-1) != bytes[DAISY_FRAME_BYTES-1]) {
+		crc_errors_++;
+		return false;
+	}
+	frame.full_cycle_len_us = bytes[0] | ((unsigned long)bytes[1] << 8) | ((unsigned long)bytes[2] << 16);
+	frame.light_pulse_duty_len_us = bytes[3] | (bytes[4] << 8);
+	frame.flags = bytes[5];
+	frame.node = bytes[6];
+	frame.status = bytes[7] | (bytes[8] << 8);
+	return true;
+}
@@ -0,0 +1,79 @@
+///*******************************************
+///@file daisyFrame.h
+///@brief Frame carrying the configuration of a leader to its follower over the daisy chain.
+///      Each bit is one rising edge of the clock OUT0, with the data lines OUT1/OUT2 giving
+///      the codes DAISY_INPUT_FRAME_BIT0/1 that are not used by the commands. The frame is
+///      sent in the dead time after CYCLE_START, which resets the receiver. Bytes go out
+///      least significant bit first and end with a CRC-8.
+///      The frame also collects the status of the chain: every node sends its own number and
+///      the status of all nodes up to and including itself, so the last node knows all of them.
+///*******************************************
+
+#ifndef DAISY_FRAME_H
+#define DAISY_FRAME_H
+
+#include <Arduino.h>
+
+constexpr uint8_t DAISY_FRAME_BYTES = 10;	// 3 cycle length, 2 duty length, 1 flags, 1 node, 2 status, 1 CRC
+constexpr uint8_t DAISY_FRAME_BITS = DAISY_FRAME_BYTES*8;
+
+constexpr uint8_t DAISY_FRAME_FLAG_EXTERNAL_TRIGGER = 1;
+
+constexpr uint8_t DAISY_CHAIN_MAX_NODES = 8;		// nodes whose status fits into the frame
+constexpr uint8_t DAISY_NODE_STATUS_BITS = 2;		// bits per node in daisy_frame::status
+constexpr uint8_t DAISY_NODE_CAMERA_WORKS = 1;		// the camera of the node took the last image
+constexpr uint8_t DAISY_NODE_ERROR = 2;				// the error LED of the node is on
+
+struct daisy_frame {
+	unsigned long full_cycle_len_us;		// [us] 24 bit
+	uint16_t light_pulse_duty_len_us;		// [us]
+	uint8_t flags;							// DAISY_FRAME_FLAG_*
+	uint8_t node;							// number of the sending node, 0 is the head of the chain
+	uint16_t status;						// DAISY_NODE_* of node n in bits 2n and 2n+1
+};
+
+/// @brief CRC-8 with polynomial 0x07
+uint8_t daisyFrameCrc(const uint8_t* data, uint8_t len);
+
+/// @brief serialize the frame including its CRC
+void daisyFrameEncode(const daisy_frame& frame, uint8_t bytes[DAISY_FRAME_BYTES]);
+
+class DaisyFrameReceiver
+{
+	public:
+	DaisyFrameReceiver();
+
+	/// @brief called by the interrupt with CYCLE_START, a new frame follows
+	inline void reset() { bits_ = 0; complete_ = false; }
+
+	/// @brief called by the interrupt with every bit. Bits after a complete frame are ignored
+	inline void push(bool bit) {
+		if (bits_ >= DAISY_FRAME_BITS)
+			return;
+		uint8_t mask = 1 << (bits_ & 7);
+		if (bit)
+			buffer_[bits_ >> 3] |= mask;
+		else
+			buffer_[bits_ >> 3] &= ~mask;
+		bits_++;
+		if (bits_ == DAISY_FRAME_BITS)
+			complete_ = true;
+	}
+
+	/// @brief true if a complete frame waits for pop()
+	inline bool available() const { return complete_; }
+
+	/// @brief called by loop(), returns true once per complete frame with a valid CRC
+	bool pop(daisy_frame& frame);
+
+	/// @brief number of frames dropped because of their CRC since start
+	uint16_t crcErrors() const { return crc_errors_; }
+
+	private:
+	volatile uint8_t buffer_[DAISY_FRAME_BYTES];
+	volatile uint8_t bits_;
+	volatile bool complete_;
+	uint16_t crc_errors_;
+};
+
+#endif // DAISY_FRAME_H
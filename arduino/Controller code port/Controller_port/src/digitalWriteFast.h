@@ -489,4 +489,16 @@ if (__builtin_constant_p(P)) { \
 #endif
 
 
+#if (defined(__AVR__) || defined(ARDUINO_ARCH_AVR))
+// output register and bit mask of a pin, used to write several pins of the same port at once
+#define portOutputRegisterFast(P) (__digitalPinToPortReg(P))
+#define digitalPinToBitMaskFast(P) ((uint8_t)(1 << __digitalPinToBit(P)))
+// true if both pins are on the same port, constant for constant pins
+#define digitalPinsSharePortFast(P1, P2) (__digitalPinToPortReg(P1) == __digitalPinToPortReg(P2))
+// one read-modify-write of a port. Not atomic, interrupts writing the same port must be disabled
+#define portWriteFast(P, SET_MASK, CLEAR_MASK) \
+  (*__digitalPinToPortReg(P) = (*__digitalPinToPortReg(P) & ~(CLEAR_MASK)) | (SET_MASK))
+#endif
+
+
 #endif //__digitalWriteFast_h_
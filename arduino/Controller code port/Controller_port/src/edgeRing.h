@@ -0,0 +1,59 @@
+///*******************************************
+///@file edgeRing.h
+///@brief Lock-free ring of timestamped input edges. The interrupt only takes the time
+///      and pushes the edge, loop() pops and evaluates it later. Single writer (the
+///      interrupt) and single reader (loop()), so no interrupts need to be disabled.
+///*******************************************
+
+#ifndef EDGE_RING_H
+#define EDGE_RING_H
+
+#include <Arduino.h>
+
+constexpr uint8_t EDGE_RING_SIZE = 8;			// must be a power of 2
+
+struct edge_event {
+	unsigned long at_us;			// [us] time taken in the interrupt
+	uint8_t level;					// level of the pin after the edge
+};
+
+class EdgeRing
+{
+	public:
+	EdgeRing() { head_ = 0; tail_ = 0; lost_ = 0; }
+
+	/// @brief called by the interrupt. If loop() did not keep up, the edge is lost and counted
+	inline void push(unsigned long at_us, uint8_t level) {
+		if ((uint8_t)(head_ - tail_) >= EDGE_RING_SIZE) {
+			lost_++;
+			return;
+		}
+		volatile edge_event& edge = ring_[head_ & (EDGE_RING_SIZE-1)];
+		edge.at_us = at_us;
+		edge.level = level;
+		// publish the edge only once it is complete
+		head_++;
+	}
+
+	/// @brief called by loop(), returns false if there is no edge
+	inline bool pop(edge_event& edge) {
+		if (head_ == tail_)
+			return false;
+		volatile edge_event& queued = ring_[tail_ & (EDGE_RING_SIZE-1)];
+		edge.at_us = queued.at_us;
+		edge.level = queued.level;
+		tail_++;
+		return true;
+	}
+
+	/// @brief number of edges lost since start
+	uint8_t lost() const { return lost_; }
+
+	private:
+	volatile edge_event ring_[EDGE_RING_SIZE];
+	volatile uint8_t head_;			// written by the interrupt only
+	volatile uint8_t tail_;			// written by loop() only
+	volatile uint8_t lost_;
+};
+
+#endif // EDGE_RING_H
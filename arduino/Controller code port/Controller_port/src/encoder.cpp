@@ -0,0 +1,88 @@
+///*******************************************
+///@file encoder.cpp
+///@brief Counts the pulses of the conveyor's encoder and triggers an image every n counts.
+///*******************************************
+
+#include "encoder.h"
+#include "gpPins.h"
+#include "digitalWriteFast.h"
+#include "timebase.h"
+
+Encoder encoder;
+
+Encoder::Encoder() {
+	position_ = 0;
+	next_trigger_ = 0;
+	counts_per_image_ = 0;
+	trigger_us_ = 0;
+	triggered_ = false;
+	last_trigger_us_ = 0;
+	last_a_ = LOW;
+}
+
+// channel A is no external interrupt pin, so its pin change interrupt is used
+ISR(PCINT1_vect) {
+	encoder.count();
+}
+
+void Encoder::setup() {
+	pinMode(PIN_ENCODER_A, INPUT_PULLUP);
+	pinMode(PIN_ENCODER_B, INPUT_PULLUP);
+	last_a_ = digitalReadFast(PIN_ENCODER_A);
+	*digitalPinToPCMSK(PIN_ENCODER_A) |= _BV(digitalPinToPCMSKbit(PIN_ENCODER_A));
+	PCIFR = _BV(digitalPinToPCICRbit(PIN_ENCODER_A));
+	*digitalPinToPCICR(PIN_ENCODER_A) |= _BV(digitalPinToPCICRbit(PIN_ENCODER_A));
+}
+
+void Encoder::setCountsPerImage(unsigned long counts) {
+	uint8_t sreg = SREG;
+	cli();
+	counts_per_image_ = counts;
+	next_trigger_ = position_ + counts;
+	triggered_ = false;
+	SREG = sreg;
+	last_trigger_us_ = 0;
+}
+
+bool Encoder::pollTrigger(unsigned long& interval_us) {
+	if (!triggered_)
+		return false;
+	uint8_t sreg = SREG;
+	cli();
+	unsigned long trigger_us = trigger_us_;
+	triggered_ = false;
+	SREG = sreg;
+
+	interval_us = (last_trigger_us_ != 0)?(trigger_us - last_trigger_us_):0;
+	last_trigger_us_ = trigger_us;
+	return true;
+}
+
+long Encoder::position() {
+	uint8_t sreg = SREG;
+	cli();
+	long position = position_;
+	SREG = sreg;
+	return position;
+}
+
+void Encoder::count() {
+	// the other pins of the port trigger the same interrupt, only rising edges of A count
+	uint8_t a = digitalReadFast(PIN_ENCODER_A);
+	if ((a == last_a_) || (a == LOW)) {
+		last_a_ = a;
+		return;
+	}
+	last_a_ = a;
+
+	if (digitalReadFast(PIN_ENCODER_B) == HIGH)
+		position_++;
+	else
+		position_--;
+
+	if ((counts_per_image_ != 0) && ((long)(position_ - next_trigger_) >= 0)) {
+		trigger_us_ = timebase.micros();
+		triggered_ = true;
+		next_trigger_ += counts_per_image_;
+	}
+}
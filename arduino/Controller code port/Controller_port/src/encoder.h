@@ -0,0 +1,49 @@
+///*******************************************
+///@file encoder.h
+///@brief Counts the pulses of the conveyor's encoder and triggers an image every n counts.
+///      Channel A is counted on its rising edge, channel B gives the direction (quadrature).
+///      A single-phase encoder leaves B open, its pull-up reads as forward.
+///      The interrupt takes the time of the trigger, loop() picks it up with pollTrigger()
+///      together with the time it took the belt to move by n counts.
+///*******************************************
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <Arduino.h>
+
+class Encoder
+{
+	public:
+	Encoder();
+
+	/// @brief configure the pins and their interrupt
+	void setup();
+
+	/// @brief trigger an image every counts of the encoder, 0 turns triggering off.
+	///			The next trigger is counts from the current position
+	void setCountsPerImage(unsigned long counts);
+
+	/// @brief returns true once per trigger
+	/// @param interval_us [us] time since the previous trigger, 0 if there was none
+	bool pollTrigger(unsigned long& interval_us);
+
+	/// @brief current position in counts of the encoder
+	long position();
+
+	/// @brief called by the interrupt on every change of channel A
+	void count();
+
+	private:
+	volatile long position_;				// [counts]
+	volatile long next_trigger_;			// [counts] position of the next trigger
+	volatile unsigned long counts_per_image_;
+	volatile unsigned long trigger_us_;		// [us] time of the last trigger, taken in the interrupt
+	volatile bool triggered_;
+	unsigned long last_trigger_us_;			// [us] time of the trigger before, 0 if none
+	uint8_t last_a_;						// level of channel A after the last interrupt
+};
+
+extern Encoder encoder;
+
+#endif // ENCODER_H
@@ -9,7 +9,7 @@
 #include <Arduino.h>
 
 #ifdef __AVR__
-    //#define CONTROLLINO_MINI
+    #define CONTROLLINO_MINI
 #endif
 
 #ifdef CONTROLLINO_MINI
@@ -26,6 +26,15 @@
     #define PIN_DAISY_IN0 2							// interruptible PIN, Daisy Chain Input Pin
     #define PIN_DAISY_IN1 PIN_A0					// Daisy Chain Input Pin
     #define PIN_DAISY_IN2 PIN_A1					// Daisy Chain Input Pin
+    #define PIN_ENCODER_A PIN_A2					// conveyor encoder channel A, counted by its pin change interrupt
+    #define PIN_ENCODER_B PIN_A3					// conveyor encoder channel B, direction
+
+    #define PIN_NIR_TRIGGER_IN 13					// output PIN to be connected to the NIR camera's trigger pin, sub-trigger channel 0
+    #define SUB_TRIGGER_PINS { PIN_NIR_TRIGGER_IN, 4, 5, 6, 8 }	// free output PINs the sub-trigger channels can use, Controllino D0, D1, D2, D4
+
+    // the timeline writes all pins of a port switching at the same time at once:
+    // PORTB: PIN_DAISY_OUT0/1/2, PIN_NIR_TRIGGER_IN, PORTC: PIN_LIGHTING_PNP, PIN_CAMERA_TRIGGER_IN,
+    // PORTD: sub-trigger channels on PIN 4, 5 or 6
 
 #else
     // connections to the camera and the lights
@@ -41,6 +50,10 @@
     #define PIN_DAISY_IN0 2							// interruptible PIN, Daisy Chain Input Pin
     #define PIN_DAISY_IN1 PIN_A0					// Daisy Chain Input Pin
     #define PIN_DAISY_IN2 PIN_A1					// Daisy Chain Input Pin
+    #define PIN_ENCODER_A PIN_A2					// conveyor encoder channel A, counted by its pin change interrupt
+    #define PIN_ENCODER_B PIN_A3					// conveyor encoder channel B, direction
+
+    #define SUB_TRIGGER_PINS { 4, 6, 8 }			// free output PINs the sub-trigger channels can use
 #endif
 
 
@@ -7,8 +7,34 @@
 #define GPVERSION_H
 
 // whenever EEPROM data structure  or the programme changes, increase this number
-constexpr int VERSION = 48;
+constexpr int VERSION = 74;
 // History:
+// V74: Head of a ring gets the status of all nodes back from the last node of the chain, w/W turns it on/off
+// V73: S stages several configuration values and applies them together at the next cycle boundary
+// V72: Telemetry frame after every camera cycle, turned on by m/M or the binary protocol
+// V71: Serial output is queued and sent in the slack, the help page is printed section by section
+// V70: Serial commands are parsed without heap, all characters available are read in one go
+// V69: Binary protocol with SLIP framing and CRC-16 gets or sets any subset of configuration and status
+// V68: Sub-triggers interleaved with the light pulses, i/I turns it on/off
+// V67: Sub-trigger channels u<ch>,<pin>,<mul>,<div>,<us>,<us> replace the fixed NIR trigger
+// V66: IN0 interrupt rejects glitches and cycle starts coming too early, g<us> sets the min interval
+// V65: External trigger predicts the next trigger and strobes with a configurable plan x<count>,<spacing>,<lead>
+// V64: Follower holds the leader's period and phase when the leader gets lost
+// V63: Daisy chain frame collects number and status of all nodes, returned by q
+// V62: Phase offset o<us> staggers the pulses of the stations of a daisy chain
+// V61: Follower compensates the latency of the daisy chain hop and the leader's pulse, measured by a loopback
+// V60: Leader sends its cycle length, duty length and trigger mode to its follower over the daisy chain
+// V59: Daisy chain follower is phase locked to its leader instead of stepping through a table of frequencies
+// V58: Encoder mode, the camera is triggered every n counts of the conveyor encoder
+// V57: Frequency, duty and calibration changes take effect at the next cycle boundary without restart
+// V56: Frame rate can be set in fractions of a Hz from 0.5Hz to 60Hz
+// V55: Schedule runs on a Timer1 time base with 0.5us ticks instead of micros()
+// V54: Remainder of the pulse period is spread evenly over the cycle
+// V53: Paperwork is dispatched by a scheduler in the slack until the next event
+// V52: STROBE_OUT edges are timestamped in the interrupt and evaluated in loop()
+// V51: Edges at the same time are written with one access per port
+// V50: All edges of a cycle are precompiled into a timeline of events
+// V49: Lights and camera trigger edges are output by Timer1 compare interrupts
 // V48: Fix numerical accuracy in computeCycleLengths()
 // V47: Added external trigger support t/T to toggle over serial
 // V46: NIR pulse sync support for integration
@@ -10,28 +10,19 @@
 #include <avr/wdt.h>  // watchdog
 #include "digitalWriteFast.h"
 #include "controllerErrors.h"
-
-// whenever EEPROM data structure  or the programme changes, increase this number
-#define VERSION 48
-// History:
-// V48: Fix numerical accuracy in computeCycleLengths()
-// V47: Added external trigger support t/T to toggle over serial
-// V46: NIR pulse sync support for integration
-// V45: ttyUSB support, daisy chaining now supports camera frequency update
-// V44: introduced propagation cycle
-// V43: Increased max duty cycle
-// V42: Improved measurement between Controllino and AVR pin
-// V41: Daisy chaining
-// V40: bugfix: increasing the frequency caused the controller to reset
-// V37-39: more measurements, and adjusted accordingly
-// V36: made serial command input faster
-// V35: better logging and documentation
-// V34: After measurements with a scope massive improvement of timing
-// V33: Timing improvement
-// V32: Quicker Adjustment to changes of exposure time
-// V31: Changed Fan PIN to 7
-// V30: Changed Fan PIN to 9
-// V29: Changed Fan PIN to 8
+#include "gpPins.h"
+#include "timebase.h"
+#include "pulseEngine.h"
+#include "timeline.h"
+#include "edgeRing.h"
+#include "scheduler.h"
+#include "encoder.h"
+#include "phaseLock.h"
+#include "daisyFrame.h"
+#include "binaryProtocol.h"
+#include "commandLine.h"
+#include "serialOut.h"
+#include "gpversion.h"		// VERSION and its history
 
 // magic number indicates if EEPROM has been initialized correctly
 const long EEPROM_MAGIC_NUMBER = 1566+VERSION;  // magic number to indicate whether the AVR's EEPROM has been initialized already
@@ -39,6 +30,9 @@ const long EEPROM_MAGIC_NUMBER = 1566+VERSION;  // magic number to indicate whet
 
 // connections to the lighting
 #define IMAGE_FREQUENCY 5						// [Hz] initial frequency of camera
+#define MIN_IMAGE_FREQUENCY_MHZ 500UL			// [mHz] lowest frequency of camera
+#define MAX_IMAGE_FREQUENCY_MHZ 60000UL			// [mHz] highest frequency of camera
+#define MAX_ENCODER_COUNTS_PER_IMAGE 1000000UL	// max counts of the encoder between two images in encoder mode
 #define PULSING_FREQUENCY 200					// [Hz] pulse frequency of strobing
 #define MAX_DUTY_LEN_US 1800					// [us] max length of duty pulse
 #define MIN_DUTY_LEN_US 200						// [us] min length of duty pulse
@@ -50,30 +44,47 @@ const long EEPROM_MAGIC_NUMBER = 1566+VERSION;  // magic number to indicate whet
 
 #define LIGHTS_PULSE_ON_DELAY 20				// [us] delay of lights to reach full brightness (datasheet)
 #define LIGHTS_PULSE_OFF_DELAY 20				// [us] delay of lights to reach full darkness (datasheet)
+#define DAISY_CLOCK_DELAY_US 1					// [us] break between daisy chain data lines and clock, required by the digital isolator
 #define WATCH_DOG_WAIT WDTO_120MS
 
-// connections to the camera and the lights
-#define PIN_ERROR_LED 9							// output PIN for the red error LED, Controllino Pin D5
-#define PIN_LIGHTING_PNP PIN_A4					// output PIN to be connect to the lights STROBE_IN, Controllino Pin D6
-#define PIN_CAMERA_TRIGGER_IN PIN_A5			// output PIN to be connected to the camera's TRIGGER_IN(+) PIN, Controllino Pin D7
-#define PIN_CAMERA_STROBE_OUT 3					// input interrupt PIN IN1 to be connected to the camera's STROBE_OUT indicating the exposure time.
-#define PIN_FAN 7								// output PIN for fan, Arduino PIN_D4, Controllino D3
-
-#define PIN_DAISY_OUT0 10						// Daisy chain output pin
-#define PIN_DAISY_OUT1 11						// Daisy chain output pin
-#define PIN_DAISY_OUT2 12						// Daisy chain output pin
-#define PIN_DAISY_IN0 2							// interruptible PIN, Daisy Chain Input Pin
-#define PIN_DAISY_IN1 PIN_A0					// Daisy Chain Input Pin
-#define PIN_DAISY_IN2 PIN_A1					// Daisy Chain Input Pin
+// events of the timeline are output by Timer1 compare interrupts of the pulse engine,
+// loop() only does the bookkeeping. Without, loop() polls the timeline and fires its events
+#define DO_HW_PULSE_ENGINE
 
 #define BAUD_RATE 115200						// fixed baud rate of serial interface
+#define SERIAL_COMMAND_READ_US 200				// [us] max time to read the characters of a command in one go
 #define LIGHT_PULSE_LEN_US (1000000UL/PULSING_FREQUENCY) // [us] length of the pulse including the break (represents 50Hz)
+#define TRIGGER_STROBE_COUNT 3					// pulses per external trigger
+#define MAX_TRIGGER_STROBE_COUNT 1000			// max pulses per external trigger set by x
+#define DEFAULT_MIN_TRIGGER_INTERVAL_US (1000000000UL/MAX_IMAGE_FREQUENCY_MHZ/2)	// [us] cycle starts on IN0 closer than that are noise
+
+#define SUB_TRIGGER_CHANNELS 3					// sub-triggers of further sensors, each an output of the timeline
+#define MIN_SUB_TRIGGER_LEN_US 10				// [us] min length of a sub-trigger pulse
+#define MAX_SUB_TRIGGER_LEN_US 100000UL			// [us] max length of a sub-trigger pulse
+#define NIR_TRIGGER_LEN_US 1200					// [us] length of the NIR camera trigger pulse
+#define NIR_TRIGGER_FACTOR 10					// the NIR trigger frequency is a factor of the camera frame rate
+#define CONTROLLINO_TIME_TO_GO_LOW_3V 50		// [us] measured time of ATMega328p to pull a PIN down to GND
+#define CONTROLLINO_TIME_TO_GO_HIGH_3V 4		// [us] measured time of ATMega328p to pull a PIN up to 3.3V
+#ifdef PIN_NIR_TRIGGER_IN
+#define NIR_TRIGGER_PIN PIN_NIR_TRIGGER_IN
+#else
+#define NIR_TRIGGER_PIN TIMELINE_NO_PIN
+#endif
 
+// a sub-trigger channel outputs multiplier pulses every divider images, spread evenly over the divider cycles
+struct sub_trigger_config {
+	uint8_t pin;								// TIMELINE_NO_PIN if the channel is off
+	uint8_t multiplier;							// pulses per divider images, 1..255
+	uint8_t divider;							// images, 1..255
+	unsigned long pulse_len_us;					// [us] length of a pulse
+	unsigned long offset_us;					// [us] first pulse after the cycle start
+};
 
-#define COMPUTE_SCALING_FACTOR 2000									// scaling factor to use during computeCycleLengths() to fix numerical accuracy issues
-#define COMPUTE_SCALING_FACTOR_DIV2 COMPUTE_SCALING_FACTOR/2		// as above but divided by 2
 
-const uint8_t number_of_error_codes = (StrobingControllerError::Unknown)+1;
+// the shortest cycle needs to hold at least one pulse with the minimum duty
+static_assert(1000000000UL/MAX_IMAGE_FREQUENCY_MHZ >= MIN_DUTY_LEN_US*MAX_DUTY_RATIO, "MAX_IMAGE_FREQUENCY_MHZ too high");
+
+const uint8_t number_of_error_codes = CTRL_ERROR_ENUM_MAX;
 
 // all configuration items contained in configuration_type are stored in EEPROM
 // the following block is the EEPROM master block that refers to the data blocks
@@ -96,6 +107,11 @@ struct eeprom_master_type {
 		magic_number = eeprom_read_word((uint16_t*)0);
 		mem_bank_address = eeprom_read_word((uint16_t*)2);
 	}
+	// write just one byte of the master block (used for delayed write)
+	void writeByte(uint8_t no_of_byte) {
+		if (no_of_byte < sizeof(eeprom_master_type))
+			EEPROM.write(no_of_byte, ((uint8_t*)this)[no_of_byte]);
+	}
 	void read() {
 		magic_number = eeprom_read_word((uint16_t*)0);
 		mem_bank_address = eeprom_read_word((uint16_t*)2);
@@ -109,11 +125,8 @@ bool input_power_off = false;					// true, if we received a command via serial t
 // this functions starts very close to the end of a long
 // to simulate an overflow of micros() after 20 seconds
 inline unsigned long delayedMicros() {
-#ifdef DEBUG
-	return micros() + (0xFFFFFFFF - 20*1000000);
-#else
-	return micros();
-#endif
+	// the time base simulates the overflow itself in DEBUG
+	return timebase.micros();
 }
 
 // global time, is updated in every cycle of loop() and used nearly everywhere
@@ -127,19 +140,47 @@ struct configuration_type {
 	uint16_t no_of_strobes;						// no of pulses in a full cycle
 	bool external_trigger_mode;					// if true, we are in external trigger mode
 
-	unsigned long full_cycle_len_us;			// now_us [us] between two images. In normal operations, anything between 1000000/3 fps and 100000/20 fps is allowed
+	unsigned long full_cycle_len_us;			// [us] between two images, anything between 1000000/60 and 1000000/0.5 is allowed
 	unsigned long lights_pulse_len_us;			// [us] length of one light pulse + the break afterwards = 20ms
 	unsigned long light_pulse_duty_len_us;		// [us] length of a duty cycle of one pulse, like 1ms, always < lights_pulse_len_us
+	unsigned long encoder_counts_per_image;		// if not 0, we are in encoder mode and the camera is triggered every n counts of the encoder
+	uint16_t daisy_chain_hop_latency_us;		// [us] from the leader's daisy chain output to the interrupt of its follower
+	unsigned long phase_offset_us;				// [us] pulses and camera trigger start this late after the cycle start
+	uint16_t trigger_strobe_count;				// pulses per external trigger, including the ones before it
+	uint16_t trigger_lead_strobes;				// pulses before the predicted external trigger
+	unsigned long trigger_strobe_spacing_us;	// [us] distance between two pulses in external trigger mode
+	unsigned long min_trigger_interval_us;		// [us] cycle starts of the leader or the external trigger coming earlier are rejected
+	sub_trigger_config sub_triggers[SUB_TRIGGER_CHANNELS];
+	bool sub_trigger_interleaved;				// if true, sub-trigger pulses are placed in the dark between the light pulses
+	bool daisy_chain_ring;						// if true, this is the head of a ring, the last node's OUT0..2 are wired back to its IN0..2
 
 	// initialize all configuration values to factory settings
 	void setup() {
 		write_counter = 0;
 		auto_mode_on = true;											// if true, light is derived out of exposure time
-		full_cycle_len_us = 1000000UL/IMAGE_FREQUENCY;					// now_us [us] between two images. In normal operations, anything between 1000000/3 fps and 100000/20 fps is allowed
+		full_cycle_len_us = 1000000UL/IMAGE_FREQUENCY;					// [us] between two images, anything between 1000000/60 and 1000000/0.5 is allowed
 		lights_pulse_len_us = LIGHT_PULSE_LEN_US;						// [us] length of one light pulse + the break afterwards = 10ms = 100 Hz
 		no_of_strobes = full_cycle_len_us/lights_pulse_len_us;			// no of pulses in a full cycle
 		light_pulse_duty_len_us = lights_pulse_len_us/MAX_DUTY_RATIO;	// [us] length of a duty cycle of one pulse, like 1ms, always < lights_pulse_len_us
 		external_trigger_mode = false;									// if true, we are in external trigger mode
+		encoder_counts_per_image = 0;									// if not 0, we are in encoder mode
+		daisy_chain_hop_latency_us = 0;									// [us] not measured
+		phase_offset_us = 0;											// [us] pulses start with the cycle
+		trigger_strobe_count = TRIGGER_STROBE_COUNT;					// pulses per external trigger
+		trigger_lead_strobes = 0;										// no pulses before the external trigger
+		trigger_strobe_spacing_us = LIGHT_PULSE_LEN_US;					// [us] distance between two pulses in external trigger mode
+		min_trigger_interval_us = DEFAULT_MIN_TRIGGER_INTERVAL_US;		// [us] half the cycle at max frame rate
+		for (uint8_t ch = 0; ch < SUB_TRIGGER_CHANNELS; ch++) {
+			sub_triggers[ch].pin = TIMELINE_NO_PIN;
+			sub_triggers[ch].multiplier = 1;
+			sub_triggers[ch].divider = 1;
+			sub_triggers[ch].pulse_len_us = NIR_TRIGGER_LEN_US;
+			sub_triggers[ch].offset_us = 0;
+		}
+		sub_triggers[0].pin = NIR_TRIGGER_PIN;							// channel 0 is the NIR camera
+		sub_triggers[0].multiplier = NIR_TRIGGER_FACTOR;
+		sub_trigger_interleaved = false;								// sub-triggers run with their own offset
+		daisy_chain_ring = false;										// open chain, the head has no input
 	}
 
 	void write() ;
@@ -168,18 +209,15 @@ void configuration_type::writeByte(uint16_t no_of_byte) {
 unsigned long start_cycle_time_us = 0;			// [us] start time of the current cycle [us]
 volatile unsigned long input_full_cycle_len_us = 0;		// [us] input len of full image grabbing cycle with delayed write to config
 unsigned long input_light_pulse_duty_len_us = 0;// [us] length of strobing pulse
-unsigned long next_pulse_start_time  = 0;		// [us] precomputed next pulse start time
-unsigned long next_pulse_end_time  = 0;			// [us] precomputed next pulse end time
-unsigned long next_camera_off_time = 0;			// [us] precomputed time to turn off the camera trigger pulse
 
 unsigned long interrupt_time_us = 0;			// [us] the time the interrupt function was called [us]
 unsigned long last_interrupt_time_us = 0;		// [us] the time the previous interrupt function was called [us]
 
-constexpr unsigned long TWO_SECONDS_IN_us = 2000000UL;	// [us] 2 seconds
-unsigned long external_trigger_period_us = TWO_SECONDS_IN_us; 	//[us] the period of time the lights will be on after an external trigger
+unsigned long external_trigger_period_us = 0; 	// [us] filtered period of the external trigger, 0 if unknown
+uint16_t trigger_lead_strobes = 0;				// pulses of the cycle leading to the predicted next trigger
 unsigned long cycle_time_estimate = 0;		// estimated length of the cycle for external trigger mode.
 
-bool freqChange_request = false; 			// A frequency change has been requested.
+bool freqChange_request = false; 			// A frequency change has been requested, applied at the next cycle boundary
 
 #ifdef DEBUG
 bool debugging_mode = false;					// if true, each pulse is sent to Serial with a nice pattern
@@ -197,6 +235,21 @@ unsigned long nth_strobe = 0;					// counting the current number of pulses withi
 
 // possible states of the main loop
 bool pulse_state = false;
+bool camera_cycle = true;						// false if the current cycle only strobes the lights, used in encoder mode while waiting for the next count
+unsigned long last_pulse_off_us = 0;			// [us] time the last light pulse went off
+
+// in encoder mode the belt sets the length of the cycle. It is not part of the configuration, so it
+// is neither stored in EEPROM nor kept when leaving encoder mode
+unsigned long encoder_period_us = 0;			// [us] cycle length measured by the encoder, 0 if unknown
+uint16_t encoder_no_of_strobes = 1;				// pulses spread over encoder_period_us
+
+inline bool encoderCycle() {
+	return (encoder_period_us != 0) && (config.encoder_counts_per_image != 0) && !config.external_trigger_mode;
+}
+
+// [us] length and number of pulses of the running cycle
+inline unsigned long cycleLen() { return encoderCycle()?encoder_period_us:config.full_cycle_len_us; }
+inline uint16_t cycleStrobes() { return encoderCycle()?encoder_no_of_strobes:config.no_of_strobes; }
 
 // the following variables are used while checking of an image really has been taken
 // if all become true on one cycle, camera_works is set and the flags are reset for the next cycle
@@ -204,16 +257,19 @@ bool pulse_state = false;
 bool image_capture_turned_on = false;					// becomes true when the camera gets the command to trigger by pin TRIGGER_IN
 bool image_start_latch = false;					// becomes true, when camera tells that image is being taken, set by interrupt on STROBE_OUT
 bool image_done_latch = false;					// becomes true, if camera tells that exposure is finished.
+unsigned long image_trigger_us = 0;				// [us] time the camera has been triggered in the current cycle
 bool camera_works	= false;					// is true of the STROBE signal is given
 
 // variables to measure timing
 unsigned long camera_exposure_us = 0;			// measurement of camera exposure time
+unsigned long camera_exposure_last_us = 0;		// [us] exposure of the last image, 0 if none in this cycle
 unsigned long camera_exposure_avr_us = 0;		// average measurement of camera exposure time
 unsigned long camera_exposure_last_avr_us = 0;	// last average that was taken for frequency calibration
 unsigned long camera_exposure_avr_deriv_us = 0; // derivative of change of the exposure time. Used to detect
 												// if the exposure time became stable and can be used for calibration
+EdgeRing camera_strobe_edges;					// edges of STROBE_OUT with the time taken in the interrupt
 
-String command = "";							// command input, used to add up characters coming from serial interface
+CommandLine command;							// command input, used to add up characters coming from serial interface
 bool command_pending = false;
 // commands have a timeout when characters are coming in too slow or the final <CR> is missing.
 unsigned long cmd_last_char_us = 0;				// Time when the last character has been keyed in
@@ -225,8 +281,8 @@ void printError(uint8_t err_no) {
 	uint16_t now_ms = millis();
 	if ((last_error_now_us_ms[err_no] == 0) || ((now_ms - last_error_now_us_ms[err_no]) > 1000)) {
 		last_error_now_us_ms[err_no] = now_ms;
-		Serial.print('E');
-		Serial.println(err_no);
+		serial_out.print('E');
+		serial_out.println(err_no);
 	}
 }
 
@@ -247,8 +303,9 @@ void measureImageCapture() {
 
     if(!config.external_trigger_mode)
     {
-      // use a complementary filter for the measurement
-      measure_image_capture_duration_us = (measure_image_capture_duration_us*7168 + value_us*1024)/8192;
+      // use a complementary filter for the measurement, 7/8 of the old and 1/8 of the new value.
+      // Computed on the difference, so cycles of seconds do not overflow
+      measure_image_capture_duration_us += (long)(value_us - measure_image_capture_duration_us)/8;
     }
 		measure_last_image_us = now_us;
 	}
@@ -259,18 +316,21 @@ unsigned long measure_pulse_dev_us = 0;				// [us] average deviation of duty len
 unsigned long measure_pulse_max_dev_us = 0;			// [us] sliding average of max duty
 unsigned long measure_pulse_duty_dev_us = 0;		// [us] average deviation of duty length
 unsigned long measure_pulse_duty_max_dev_us = 0;	// [us] sliding average of max duty
+#endif
 
-// called whenever a light pulse happens, measures the average duration between two pulses
+// called whenever a light pulse happens, measures the average duration between two pulses.
+// pulse_on_us is the time the timeline actually output the edge, not the time loop() sees it
 unsigned long measure_pulse_start_us = 0; // [us] start time of last pulse, used in measurePulseEnd
-void measurePulseStart() {
+void measurePulseStart(unsigned long pulse_on_us) {
 	if (measure_pulse_start_us == 0) {
-		measure_pulse_start_us = now_us;
+		measure_pulse_start_us = pulse_on_us;
 	} else {
-		unsigned long value_us = now_us-measure_pulse_start_us;
-		measure_pulse_start_us = now_us;
+		unsigned long value_us = pulse_on_us-measure_pulse_start_us;
+		measure_pulse_start_us = pulse_on_us;
 		// use a complementary filter for the measurement
 		measure_pulse_cycle_duration_us = (measure_pulse_cycle_duration_us*(2048-128) + (value_us<<7)) >> 11;
 
+#ifdef DEBUG
 		unsigned long pulse_dev = value_us > config.lights_pulse_len_us?value_us - config.lights_pulse_len_us:config.lights_pulse_len_us-value_us;
 		measure_pulse_dev_us = (measure_pulse_dev_us*(2048-64) + (pulse_dev<<6)) >> 11;
 		if (measure_pulse_dev_us > measure_pulse_max_dev_us) {
@@ -278,15 +338,20 @@ void measurePulseStart() {
 	}
 	else
 		measure_pulse_max_dev_us = (measure_pulse_max_dev_us *( 2048-16)) >> 11;
+#endif
 	}
 }
 
 // called whenever a light pulse happens, measures the average duration between two pulses and the average duty cycle
-void measurePulseEnd() {
-	unsigned long value_us = now_us-measure_pulse_start_us;
+void measurePulseEnd(unsigned long pulse_off_us) {
+	// the pulse started before the measurement has been reset
+	if (measure_pulse_start_us == 0)
+		return;
+	unsigned long value_us = pulse_off_us-measure_pulse_start_us;
 	// use a complementary filter for the measurement
 	measure_pulse_duty_duration_us = (measure_pulse_duty_duration_us*(2048 -128) + (value_us<<7)) >> 11;
 
+#ifdef DEBUG
 	unsigned long pulse_duty_dev = value_us > config.light_pulse_duty_len_us?value_us - config.light_pulse_duty_len_us:config.light_pulse_duty_len_us- value_us;
 	measure_pulse_duty_dev_us = (measure_pulse_duty_dev_us*(2048-64) + (pulse_duty_dev<<6))>> 11;
 	if (pulse_duty_dev > measure_pulse_duty_max_dev_us) {
@@ -294,101 +359,143 @@ void measurePulseEnd() {
 	}
 	else
 		measure_pulse_duty_max_dev_us = (measure_pulse_duty_max_dev_us*(2048-16))>> 11;
-}
 #endif
+}
 
-void printMeasurements() {
-  Serial.println(F("Validation"));
+// prints the frequency of a period with three decimals, like 7.500Hz
+void printFrequency(unsigned long period_us) {
+	if (period_us == 0) {
+		serial_out.print('-');
+		return;
+	}
+	unsigned long freq_mhz = (1000000000UL + period_us/2)/period_us;
+	serial_out.print(freq_mhz/1000);
+	serial_out.print('.');
+	unsigned long fraction = freq_mhz % 1000;
+	if (fraction < 100)
+		serial_out.print('0');
+	if (fraction < 10)
+		serial_out.print('0');
+	serial_out.print(fraction);
+}
 
-  if(config.external_trigger_mode)
-  {
-    measure_image_capture_duration_us = cycle_time_estimate;
-  }
-  Serial.print(F("  len between two images  : "));
-  Serial.print(measure_image_capture_duration_us);
-  Serial.print(F("[us] = "));
-  Serial.print(1000000UL/measure_image_capture_duration_us);
-  Serial.println(F("Hz"));
-
-  Serial.print(F("  len of light pulse      : "));
-  Serial.print(measure_pulse_cycle_duration_us);
-  Serial.print(F("[us] = "));
-  Serial.print(1000000UL/measure_pulse_cycle_duration_us);
+// prints section no of the measurements, returns false if there is none
+bool printMeasurements(uint8_t section) {
+  switch (section) {
+    case 0:
+      serial_out.println(F("Validation"));
+
+      if(config.external_trigger_mode)
+      {
+        measure_image_capture_duration_us = cycle_time_estimate;
+      }
+      serial_out.print(F("  len between two images  : "));
+      serial_out.print(measure_image_capture_duration_us);
+      serial_out.print(F("[us] = "));
+      printFrequency(measure_image_capture_duration_us);
+      serial_out.println(F("Hz"));
+      return true;
+
+    case 1:
+      serial_out.print(F("  len of light pulse      : "));
+      serial_out.print(measure_pulse_cycle_duration_us);
+      serial_out.print(F("[us] = "));
+      serial_out.print(1000000UL/measure_pulse_cycle_duration_us);
 #ifdef DEBUG
-  Serial.print(F("Hz dev="));
-  Serial.print(measure_pulse_dev_us);
-  Serial.print(F("[us] max="));
-  Serial.print(measure_pulse_max_dev_us);
-  Serial.println(F("[us]"));
+      serial_out.print(F("Hz dev="));
+      serial_out.print(measure_pulse_dev_us);
+      serial_out.print(F("[us] max="));
+      serial_out.print(measure_pulse_max_dev_us);
+      serial_out.println(F("[us]"));
 #endif
+      return true;
 
-  Serial.print(F("  duty len of light pulse : "));
-  Serial.print(measure_pulse_duty_duration_us - CONTROLLINO_TIME_TO_GO_HIGH + CONTROLLINO_TIME_TO_GO_LOW);
+    case 2:
+      serial_out.print(F("  duty len of light pulse : "));
+      serial_out.print(measure_pulse_duty_duration_us - CONTROLLINO_TIME_TO_GO_HIGH + CONTROLLINO_TIME_TO_GO_LOW);
 #ifdef DEBUG
-  Serial.print(F("[us] dev="));
-  Serial.print(measure_pulse_duty_dev_us);
-  Serial.print(F("[us] max="));
-  Serial.print(measure_pulse_duty_max_dev_us);
-  Serial.println(F("[us]"));
+      serial_out.print(F("[us] dev="));
+      serial_out.print(measure_pulse_duty_dev_us);
+      serial_out.print(F("[us] max="));
+      serial_out.print(measure_pulse_duty_max_dev_us);
+      serial_out.println(F("[us]"));
 #endif
-
-  Serial.print(F("  camera exposure time    : "));
-  if (camera_exposure_avr_us != 0) {
-    Serial.print(camera_exposure_avr_us);
-    Serial.print(F("[us] = 1/"));
-    Serial.print(1000000UL/(camera_exposure_avr_us));
-    Serial.println(F("s"));
+      return true;
+
+    case 3:
+      serial_out.print(F("  camera exposure time    : "));
+      if (camera_exposure_avr_us != 0) {
+        serial_out.print(camera_exposure_avr_us);
+        serial_out.print(F("[us] = 1/"));
+        serial_out.print(1000000UL/(camera_exposure_avr_us));
+        serial_out.println(F("s"));
+      }
+      if (camera_strobe_edges.lost() != 0) {
+        serial_out.print(F("  lost STROBE_OUT edges   : "));
+        serial_out.println(camera_strobe_edges.lost());
+      }
+      serial_out.print(F("  serial output stalls    : "));
+      serial_out.println(serial_out.stalls());
+      return true;
+
+    default:
+      // one section per task of the scheduler and the final blank line
+      if (section - 4 < scheduler.noOfTasks())
+        scheduler.printStatistics(section - 4);
+      else if (section - 4 == scheduler.noOfTasks())
+        serial_out.println();
+      else
+        return false;
+      return true;
   }
-
-  Serial.println();
 }
 
 
+bool placeSubTriggers();
+
+// number of strobes and pulse lengths of the cycle of c
+void computeStrobes(configuration_type& c) {
+	// the number of strobes per cycle is rounded to the nearest, but the pulse
+	// has to stay within the duty limits of the LED, whatever the frame rate is
+	unsigned long no_of_strobes = (c.full_cycle_len_us + c.lights_pulse_len_us/2)/c.lights_pulse_len_us;
+	unsigned long min_no_of_strobes = (c.full_cycle_len_us + MAX_DUTY_LEN_US*MAX_DUTY_RATIO - 1)/(MAX_DUTY_LEN_US*MAX_DUTY_RATIO);
+	unsigned long max_no_of_strobes = c.full_cycle_len_us/(MIN_DUTY_LEN_US*MAX_DUTY_RATIO);
+	no_of_strobes = constrain(no_of_strobes, min_no_of_strobes, max_no_of_strobes);
+	if (no_of_strobes == 0)
+		no_of_strobes = 1;
+	c.no_of_strobes = no_of_strobes;
+	c.lights_pulse_len_us = c.full_cycle_len_us/c.no_of_strobes; // now adapt the pulse cycle length to get an equal distribution of pulse
+	c.light_pulse_duty_len_us = c.lights_pulse_len_us/MAX_DUTY_RATIO;
+}
+
 void computeCycleLengths() {
-	// compute scaled versions of required values to improve numerical accuracy
-	unsigned long scaled_full_cycle_len_us = COMPUTE_SCALING_FACTOR * config.full_cycle_len_us;
-	unsigned long scaled_no_of_strobes = scaled_full_cycle_len_us/config.lights_pulse_len_us;
-	unsigned long quantised_scaled_no_of_strobes = scaled_no_of_strobes / COMPUTE_SCALING_FACTOR; // the number of strobes per cycle
-	if ((scaled_no_of_strobes - quantised_scaled_no_of_strobes * COMPUTE_SCALING_FACTOR)>COMPUTE_SCALING_FACTOR_DIV2) {
-		// round up!
-		quantised_scaled_no_of_strobes++;
-	}
-	config.no_of_strobes = quantised_scaled_no_of_strobes;
-	config.lights_pulse_len_us = config.full_cycle_len_us/config.no_of_strobes; // now adapt the pulse cycle length to get an equal distribution of pulse
-	config.light_pulse_duty_len_us = config.lights_pulse_len_us/MAX_DUTY_RATIO;
+	computeStrobes(config);
 
 	// reset start time of measurement, so first cycle is not measured
 	measure_last_image_us = 0;
-#ifdef DEBUG
 	measure_pulse_start_us = 0;
-#endif
 	measure_image_capture_duration_us = config.full_cycle_len_us;
 	measure_pulse_cycle_duration_us = config.lights_pulse_len_us;
 	measure_pulse_duty_duration_us = config.light_pulse_duty_len_us;
 
+	placeSubTriggers();
 }
 
-inline void computePulseStartTime() {
-	unsigned long start_time = start_cycle_time_us + nth_strobe * config.lights_pulse_len_us;
-	next_pulse_start_time  = start_time - CONTROLLINO_TIME_TO_GO_HIGH;
-	next_pulse_end_time  = start_time + config.light_pulse_duty_len_us - CONTROLLINO_TIME_TO_GO_LOW;
-	next_camera_off_time = start_time + CAMERA_TRIGGER_LEN_US - CONTROLLINO_TIME_TO_GO_LOW;
-}
-
-
 // configuration values are stored in eeprom_master_block.
-// Writing to EPPROM is expensive (3ms per write) so the
+// Writing to EPPROM is expensive (3.3ms per byte) so the
 // configuration struct is written bytewise in the breaks of a pulse.
 // delayedWriteConfiguration start this process,
-// every increment is supposed to call updateEPROMWrite
+// every increment is supposed to call updateEPROMWrite once the EEPROM is ready.
+// A byte is only started, the EEPROM programs it in the background
 long current_config_byte_to_write = -1;							// number of byte of config which is currently written
+int8_t current_master_byte_to_write = -1;						// number of byte of the master block which is currently written, after a new bank
 
 void delayedWriteConfiguration() {
 	current_config_byte_to_write = 0;	// start delayed write
 	config.write_counter++;				// mark an additional write cycle
 }
 
-// called regularly in pulse breaks, writes one byte to EPPROM, costs ca. 3ms
+// called regularly in pulse breaks once eeprom_is_ready(), starts writing one byte to EPPROM
 bool updateEPPROMWrite() {
 	if (current_config_byte_to_write >= 0) {
 		if (config.write_counter >= EEPROM_MAX_WRITES) {
@@ -406,43 +513,105 @@ bool updateEPPROMWrite() {
 			// finally, once the last byte has been written and we just started a new block in EEPROM
 			// mark that in the master block
 			if (config.write_counter == 0) // new EEPROM block?
-				eeprom_master_block.write();
+				current_master_byte_to_write = 0;
 		}
 		return true;
 	}
+	if (current_master_byte_to_write >= 0) {
+		eeprom_master_block.writeByte(current_master_byte_to_write);
+		current_master_byte_to_write++;
+		if (current_master_byte_to_write >= (int8_t)sizeof(eeprom_master_block))
+			current_master_byte_to_write = -1;
+		return true;
+	}
 
 	return false;
 }
 
 
-#define DO_NIR_TRIGGER
-
-#ifdef DO_NIR_TRIGGER
-
-#define PIN_NIR_TRIGGER_IN 13                   // output PIN to be connected to the NIR camera's trigger pin
-
-#define NIR_TRIGGER_LEN_US 1200                  // [us] length of the NIR camera trigger pulse
-#define CONTROLLINO_TIME_TO_GO_LOW_3V 50		// [us] measured time of ATMega328p to pull a PIN down to GND
-#define CONTROLLINO_TIME_TO_GO_HIGH_3V 4		// [us] measured time of ATMega328p to pull a PIN up to 3.3V
-
-bool nir_trigger_state = 0;
-const unsigned long nir_trigger_factor = 10;                // the NIR trigger frequency is a factor of the camera frame rate
-unsigned long nth_stripe = 0;
-unsigned long nir_trigger_cycle_len_us = 0;
-unsigned long next_nir_trigger_start_time = 0;
-unsigned long next_nir_trigger_end_time = 0;
+/******************************/
+/* Sub-triggers               */
+/******************************/
 
+// Sub-triggers fire further sensors like the NIR camera (V46), hyperspectral or thermal cameras in sync
+// with the camera. Each channel has its own pin, rate (multiplier/divider of the frame rate), pulse length
+// and offset to the cycle start, set by the u command. Channel 0 defaults to the NIR camera on
+// PIN_NIR_TRIGGER_IN with 10 pulses per image.
+// Since V68 the sub-triggers can be interleaved with the light pulses (i command), so sensors like the
+// NIR camera do not see the visible strobe. The placement is solved by placeSubTriggers() whenever the
+// cycle changes, combinations that do not fit into the dark gaps are rejected.
+
+const uint8_t sub_trigger_outputs[SUB_TRIGGER_CHANNELS] = { OUTPUT_SUB0, OUTPUT_SUB1, OUTPUT_SUB2 };
+const uint8_t sub_trigger_pins[] = SUB_TRIGGER_PINS;
+uint8_t sub_trigger_phase[SUB_TRIGGER_CHANNELS];	// cycle within the group of divider cycles
+bool sub_trigger_in_dark[SUB_TRIGGER_CHANNELS];		// all pulses of the channel fit between the light pulses
+unsigned long sub_trigger_dark_offset_us[SUB_TRIGGER_CHANNELS];	// [us] offset of the channel when interleaved
+
+// connects the timeline's output of the channel to its pin. The old pin goes LOW first
+void applySubTriggerPin(uint8_t ch) {
+	uint8_t pin = config.sub_triggers[ch].pin;
+	if (pin != TIMELINE_NO_PIN) {
+		digitalWrite(pin, LOW);
+		pinMode(pin, OUTPUT);
+	}
+	timeline.setPin((TimelineOutput)sub_trigger_outputs[ch], pin);
+	sub_trigger_phase[ch] = 0;
+}
 
-inline void computeNirTriggerStartTime() {
-	unsigned long start_time = start_cycle_time_us + nth_stripe * (nir_trigger_cycle_len_us);
-	next_nir_trigger_start_time = start_time - CONTROLLINO_TIME_TO_GO_HIGH_3V;
-	next_nir_trigger_end_time = next_nir_trigger_start_time + NIR_TRIGGER_LEN_US - CONTROLLINO_TIME_TO_GO_LOW_3V;
+// true if the pin is free for the channel in the configuration c
+bool isSubTriggerPin(uint8_t ch, uint8_t pin, const configuration_type& c = config) {
+	if (pin == TIMELINE_NO_PIN)
+		return true;
+	for (uint8_t other = 0; other < SUB_TRIGGER_CHANNELS; other++)
+		if ((other != ch) && (c.sub_triggers[other].pin == pin))
+			return false;
+	for (uint8_t i = 0; i < sizeof(sub_trigger_pins); i++)
+		if (sub_trigger_pins[i] == pin)
+			return true;
+	return false;
 }
 
-inline void computeNirCycleLengths() {
-	nir_trigger_cycle_len_us = config.full_cycle_len_us / nir_trigger_factor;
+// compiles the pulses of all sub-trigger channels that fall into the cycle. Pulse k of a group of
+// divider cycles is at k*divider/multiplier cycles, so the cycle gets the pulses with
+// phase*multiplier <= k*divider < (phase+1)*multiplier
+void compileSubTriggers(unsigned long start_ticks, unsigned long full_cycle_ticks) {
+	for (uint8_t ch = 0; ch < SUB_TRIGGER_CHANNELS; ch++) {
+		const sub_trigger_config& sub = config.sub_triggers[ch];
+		uint8_t phase = sub_trigger_phase[ch];
+		sub_trigger_phase[ch] = (phase + 1 < sub.divider)?(phase + 1):0;
+		if (sub.pin == TIMELINE_NO_PIN)
+			continue;
+
+		unsigned long first_pulse = ((unsigned long)phase*sub.multiplier + sub.divider - 1)/sub.divider;
+		unsigned long end_pulse = ((unsigned long)(phase + 1)*sub.multiplier + sub.divider - 1)/sub.divider;
+		if (first_pulse == end_pulse)
+			continue;
+		// the period is kept exactly, so interleaved pulses do not drift into the light pulses
+		unsigned long period_ticks = full_cycle_ticks*sub.divider/sub.multiplier;
+		uint16_t period_remainder = full_cycle_ticks*sub.divider % sub.multiplier;
+		unsigned long offset_us = (config.sub_trigger_interleaved && sub_trigger_in_dark[ch])?sub_trigger_dark_offset_us[ch]:sub.offset_us;
+		unsigned long first_ticks = start_ticks + (first_pulse*sub.divider - (unsigned long)phase*sub.multiplier)*full_cycle_ticks/sub.multiplier +
+									usToTicks(offset_us) % period_ticks;
+
+		// the pin of the NIR camera is a 3.3V pin of the ATmega, the others are outputs of the Controllino
+#ifdef PIN_NIR_TRIGGER_IN
+		bool direct_pin = (sub.pin == PIN_NIR_TRIGGER_IN);
+#else
+		bool direct_pin = false;
+#endif
+		unsigned long go_high_ticks = usToTicks(direct_pin?CONTROLLINO_TIME_TO_GO_HIGH_3V:CONTROLLINO_TIME_TO_GO_HIGH);
+		unsigned long go_low_ticks = usToTicks(direct_pin?CONTROLLINO_TIME_TO_GO_LOW_3V:CONTROLLINO_TIME_TO_GO_LOW);
+		// pulses of a high rate are cut to half of their period, so they do not overlap
+		unsigned long len_ticks = min(usToTicks(sub.pulse_len_us), period_ticks/2);
+		unsigned long off_delay_ticks = (len_ticks > go_low_ticks)?(len_ticks - go_low_ticks):0;
+
+		uint8_t output = sub_trigger_outputs[ch];
+		timeline.addTrain(first_ticks - go_high_ticks, period_ticks, period_remainder, sub.multiplier,
+						  end_pulse - first_pulse, output, output);
+		timeline.addTrain(first_ticks + off_delay_ticks, period_ticks, period_remainder, sub.multiplier,
+						  end_pulse - first_pulse, output, 0);
+	}
 }
-#endif // DO_NIR_TRIGGER
 
 // reading is done during setup only, so this trick is not necessary
 void readConfiguration() {
@@ -454,29 +623,29 @@ void readConfiguration() {
 
 bool trigger_return_configuration = false;
 void returnConfiguration() {
-  Serial.print('V');
-  Serial.print(VERSION);
-  Serial.print(',');
-  Serial.print(config.full_cycle_len_us);
-  Serial.print(',');
-  Serial.print(config.lights_pulse_len_us);
-  Serial.print(',');
-  Serial.print(config.light_pulse_duty_len_us);
-  Serial.print(',');
-  Serial.print(power_on);
-  Serial.print(',');
-  Serial.print(config.auto_mode_on);
-  Serial.print(',');
-  Serial.print(camera_works);
-  Serial.print(',');
-  Serial.print(error_led_mode);
-  Serial.print(',');
-  Serial.print(fan_mode);
-  Serial.print(',');
-  Serial.print(propagation_mode);
-  Serial.print(',');
-  Serial.print(config.external_trigger_mode);
-  Serial.println();
+  serial_out.print('V');
+  serial_out.print(VERSION);
+  serial_out.print(',');
+  serial_out.print(config.full_cycle_len_us);
+  serial_out.print(',');
+  serial_out.print(config.lights_pulse_len_us);
+  serial_out.print(',');
+  serial_out.print(config.light_pulse_duty_len_us);
+  serial_out.print(',');
+  serial_out.print(power_on);
+  serial_out.print(',');
+  serial_out.print(config.auto_mode_on);
+  serial_out.print(',');
+  serial_out.print(camera_works);
+  serial_out.print(',');
+  serial_out.print(error_led_mode);
+  serial_out.print(',');
+  serial_out.print(fan_mode);
+  serial_out.print(',');
+  serial_out.print(propagation_mode);
+  serial_out.print(',');
+  serial_out.print(config.external_trigger_mode);
+  serial_out.println();
 
 }
 
@@ -503,38 +672,349 @@ void returnConfiguration() {
 // New functionality in V45 tracks the time between receipt of successive daisy chain sync pulses in
 // the "follower" unit and if this deviates too far from expectation adjusts the frequency of the
 // camera cycle to try and match the master. This happens automatically.
+// Since V59 a software PLL (see phaseLock.h) replaces the table of supported frequencies. Once
+// locked, the follower runs any period of its leader and keeps its cycle start aligned with the
+// leader's CYCLE_START by adjusting the start of the next cycle, instead of restarting its cycle.
+// Since V60 the leader sends a frame with its cycle length, duty length and trigger mode in the dead
+// time after CYCLE_START (see daisyFrame.h). The follower takes over changes of these values, and
+// passes them on to its own follower in the next cycle.
+// Since V61 the follower aligns its cycle start with the leader's cycle start instead of its CYCLE_START,
+// that is sent at the end of the leader's first pulse. Additionally, the latency of the hop (output,
+// wire, isolator, interrupt) is subtracted. It is measured by the k command with the unit's OUT0..2
+// looped back to its own IN0..2, and stored in EEPROM.
+// Since V62 each station can shift its pulses and camera trigger by a phase offset (o command), so
+// adjacent stations strobe one after the other and do not light each other's images. The offset is
+// relative to the cycle start of the chain, which is passed on unshifted.
+// Since V63 the frame carries the number of the node and the status (camera works, error LED) of all
+// nodes before. The chain is one-way, so the status travels down the chain, and the q command of
+// the last node returns the status of the whole chain.
+// Since V74 the chain can be closed to a ring: the last node's OUT0..2 are wired back to IN0..2 of the
+// head, which is told by the w command. The head does not follow the CYCLE_START coming back, it only
+// takes the frame of the last node, so its q command returns number and status of all nodes. The
+// head of a ring cannot run in external trigger mode, the trigger comes in on IN0 as well.
+// Since V64 a locked follower that misses the leader's CYCLE_START goes into holdover: it keeps running
+// with the period and phase it learned, reports ErrorDaisyChainLeaderLost, and the phase lock continues
+// without restarting the cycle once the leader is back. After DAISY_CHAIN_HOLDOVER_MAX_US it gives up
+// and runs on its own. Either way the phase slews back in once the leader is back, so the cycle does
+// not jump.
+// Since V66 the interrupt samples IN0 after its edge and rejects spikes of a noisy cable that are gone
+// by then. A CYCLE_START (or external trigger) earlier than min_trigger_interval_us after the last one
+// is rejected as well, so noise cannot restart the cycle within a pulse. Both are counted.
 
 #define DAISY_INPUT_NOP 0
 #define DAISY_INPUT_CYCLE_START 1		// daisy chain command to start the cycle and turn the power on
 #define DAISY_INPUT_POWER_OFF 7			// command to turn off the power and stop synchronizing. Also used to check if all PINS are connected properly
-
-
-// a table giving supported camera frequencies for daisy chain automatic camera frequency updates.
-// We support from 1 FPS to 25 FPS inclusive, in 1 FPS increments
-const uint8_t daisy_chain_number_of_cam_freq = 25;
-unsigned long daisy_chain_cam_freq_cycle_times[daisy_chain_number_of_cam_freq] = {1000000,500000,333332,250000,200000,
-																		166664,142856,125000,111108,100000,
-																		90908,83332,76920,71428,66664,
-																		62500,58820,55552,52628,50000,
-																		47616,45452,43476,41664,40000};
-
-int daisy_chain_cycle_err = 0; // a counter giving direction of detected frequency drift. Zero = no drift
-uint8_t daisy_chain_camera_freq_index = 0; // index of the current camera frequency, as provided in the table daisy_chain_cam_freq_cycle_times
-unsigned long daisy_chain_camera_freq,daisy_chain_camera_freq_above,daisy_chain_camera_freq_below; // current, above and below values from daisy_chain_cam_freq_cycle_times table
+#define DAISY_INPUT_FRAME_BIT0 3		// bit 0 of a frame
+#define DAISY_INPUT_FRAME_BIT1 5		// bit 1 of a frame
+#define DAISY_FRAME_BIT_HOLD_US 30		// [us] clock and data of a bit are held until the follower's interrupt read them
+#define DAISY_FRAME_BIT_BREAK_US 5		// [us] clock low between two bits
+// [us] a byte of the frame blocks loop() this long: a break, 8 bits and 17 outputs with the clock delay
+#define DAISY_FRAME_BYTE_US (DAISY_FRAME_BIT_BREAK_US+8*(DAISY_FRAME_BIT_HOLD_US+DAISY_FRAME_BIT_BREAK_US)+17*DAISY_CLOCK_DELAY_US)
+#define DAISY_CHAIN_CALIBRATION_SAMPLES 16	// number of echoes averaged to measure the hop latency
+#define DAISY_CHAIN_RING_MISSED_CYCLES 3	// cycles without the frame of the last node until the ring counts as broken
+#define DAISY_CHAIN_ECHO_SETTLE_US 100	// [us] outputs are low before the next echo is sent
+#define DAISY_CHAIN_ECHO_TIMEOUT_US 1000	// [us] no echo within this time means no loopback
+#define MAX_DAISY_CHAIN_HOP_LATENCY_US 1000	// [us] max hop latency set by k<us>
+#define IN0_GLITCH_SAMPLES 3			// IN0 is sampled after its edge, the majority has to be HIGH
+#define IN0_GLITCH_SAMPLE_US 1			// [us] between two samples of IN0
+
+
+#define DAISY_CHAIN_PERIOD_TOLERANCE_US 50	// [us] smaller differences to the leader's period are corrected by the start of the cycle only
+#define DAISY_CHAIN_HOLDOVER_MAX_US 60000000UL	// [us] max time to keep the leader's period and phase without hearing from it
+
+PhaseLock phase_lock;							// locks the cycle of the follower to the cycle of the leader
+volatile unsigned long daisy_chain_start_us = 0;	// [us] time of the last CYCLE_START of the leader, taken by the interrupt
+bool freqChange_from_leader = false;			// the frequency change follows the leader and is not written to EEPROM
+bool daisy_chain_holdover = false;				// the leader got lost, the cycle keeps its period and phase
+unsigned long daisy_chain_holdover_start_us = 0;	// [us] start of the cycle the leader got lost in
+
+volatile bool daisy_chain_echo_mode = false;	// while measuring the hop latency, the interrupt only takes the time of the echo
+volatile bool daisy_chain_echo_received = false;
+volatile unsigned long daisy_chain_echo_us = 0;	// [us] time the echo has been received
+uint8_t daisy_chain_calibration_samples = 0;	// echoes left to measure the hop latency
+unsigned long daisy_chain_calibration_sum_us = 0;	// [us] sum of the latencies measured so far
+volatile uint16_t in0_glitches = 0;				// edges of IN0 rejected because it did not stay HIGH
+volatile uint16_t in0_early_cycle_starts = 0;	// CYCLE_STARTs rejected because of min_trigger_interval_us
 
 volatile bool daisy_chain_slave = false;	// indicates if we received a command from our master in the last cycle. Will be reset after every cycle and set with every master command.
-unsigned long prev_triggered_cycle_time_us = 0; // time of the previous INO trigger event. This is used for both daisy chain and external trigger mode
-bool has_cycle_start_triggered = false;  // When the interupt function is triggered we will set this to true, it will be reset in the loop() when handled.
+unsigned long prev_triggered_cycle_time_us = 0; // [us] time of the previous external trigger, taken by the interrupt, 0 if none
+volatile bool has_cycle_start_triggered = false;  // When the interupt function is triggered we will set this to true, it will be reset in the loop() when handled.
+volatile bool cycle_restart_requested = false;	// set by the interrupt when a new cycle starts, loop() recompiles the timeline
+
+DaisyFrameReceiver daisy_frame_receiver;		// frame of the leader, received by the interrupt
+daisy_frame daisy_frame_last = {0, 0, 0, 0, 0};	// last frame taken over from the leader
+uint8_t daisy_chain_node = 0;					// number of this node, 0 if there is no leader
+uint16_t daisy_chain_upstream_status = 0;		// DAISY_NODE_* of all nodes before this one
+bool trigger_return_chain_status = false;
+uint8_t daisy_frame_bytes[DAISY_FRAME_BYTES];	// frame sent to the follower
+unsigned long daisy_chain_ring_us = 0;			// [us] the frame of the last node came back to the head of the ring, 0 if never
+uint8_t daisy_chain_ring_nodes = 0;				// number of nodes of the ring, taken from that frame
+uint16_t daisy_chain_ring_status = 0;			// DAISY_NODE_* of all nodes of the ring, taken from that frame
+int8_t daisy_frame_next_byte = -1;				// next byte of the frame to send, -1 if none
+unsigned long daisy_chain_cycle_start_ticks = 0;	// [ticks] CYCLE_START of the last camera cycle compiled
+unsigned long daisy_frame_cycle_start_ticks = 0;	// [ticks] CYCLE_START the frame being sent follows
 
 void setDaisyChainOutput (uint8_t data) {
-	digitalWriteFast(PIN_DAISY_OUT2, (data & 4)?HIGH:LOW);
-	digitalWriteFast(PIN_DAISY_OUT1, (data & 2)?HIGH:LOW);
+	if (digitalPinsSharePortFast(PIN_DAISY_OUT1, PIN_DAISY_OUT2)) {
+		// both data lines at once, the pulse engine might write the same port
+		const uint8_t data_mask = digitalPinToBitMaskFast(PIN_DAISY_OUT1) | digitalPinToBitMaskFast(PIN_DAISY_OUT2);
+		uint8_t data_set = ((data & 4)?digitalPinToBitMaskFast(PIN_DAISY_OUT2):0) |
+						   ((data & 2)?digitalPinToBitMaskFast(PIN_DAISY_OUT1):0);
+		uint8_t sreg = SREG;
+		cli();
+		portWriteFast(PIN_DAISY_OUT1, data_set, data_mask & ~data_set);
+		SREG = sreg;
+	} else {
+		digitalWriteFast(PIN_DAISY_OUT2, (data & 4)?HIGH:LOW);
+		digitalWriteFast(PIN_DAISY_OUT1, (data & 2)?HIGH:LOW);
+	}
 
 	// set interrupt pin last and have a break to be sure that after the digital isolator this comes last
-	delayMicroseconds(1);
+	delayMicroseconds(DAISY_CLOCK_DELAY_US);
 	digitalWriteFast(PIN_DAISY_OUT0, (data & 1)?HIGH:LOW);
  }
 
+// DAISY_NODE_* of this node
+uint16_t nodeStatus() {
+	return (camera_works?DAISY_NODE_CAMERA_WORKS:0) | (error_led_mode?DAISY_NODE_ERROR:0);
+}
+
+// DAISY_NODE_* of all nodes up to and including this one
+uint16_t chainStatus() {
+	uint16_t status = daisy_chain_upstream_status;
+	if (daisy_chain_node < DAISY_CHAIN_MAX_NODES)
+		status |= nodeStatus() << (daisy_chain_node*DAISY_NODE_STATUS_BITS);
+	return status;
+}
+
+// number of nodes the q command returns and their DAISY_NODE_*. The head of a ring knows all of them from the
+// frame of the last node, as long as it keeps coming back. Otherwise these are the nodes up to this one
+uint8_t knownChainNodes(uint16_t& status) {
+	if (config.daisy_chain_ring && (daisy_chain_ring_us != 0) &&
+		(now_us - daisy_chain_ring_us < DAISY_CHAIN_RING_MISSED_CYCLES*cycleLen())) {
+		// the status of the head went round the ring, its own is more recent
+		status = (daisy_chain_ring_status & ~((1 << DAISY_NODE_STATUS_BITS) - 1)) | nodeStatus();
+		return daisy_chain_ring_nodes;
+	}
+	status = chainStatus();
+	return daisy_chain_node + 1;
+}
+
+// sends the next byte of the frame to the follower, a byte per call to fit into the breaks between two pulses.
+// The budget covers a byte, so the scheduler only runs it if no event of the timeline, like CYCLE_START or NOP
+// on the same outputs, is due meanwhile
+void sendDaisyChainFrameByte() {
+	// the next CYCLE_START resets the follower's receiver, the rest of the frame would be taken for the next one
+	if ((daisy_chain_cycle_start_ticks != daisy_frame_cycle_start_ticks) &&
+		((long)(daisy_chain_cycle_start_ticks - timebase.ticks()) < (long)usToTicks(DAISY_FRAME_BYTE_US))) {
+		daisy_frame_next_byte = -1;
+		return;
+	}
+
+	if (daisy_frame_next_byte == 0) {
+		daisy_frame frame;
+		frame.full_cycle_len_us = config.full_cycle_len_us;
+		frame.light_pulse_duty_len_us = config.light_pulse_duty_len_us;
+		frame.flags = config.external_trigger_mode?DAISY_FRAME_FLAG_EXTERNAL_TRIGGER:0;
+		frame.node = daisy_chain_node;
+		frame.status = chainStatus();
+		daisyFrameEncode(frame, daisy_frame_bytes);
+	}
+
+	// clock is still high from CYCLE_START or the last bit
+	setDaisyChainOutput(DAISY_INPUT_NOP);
+	delayMicroseconds(DAISY_FRAME_BIT_BREAK_US);
+	uint8_t data = daisy_frame_bytes[daisy_frame_next_byte];
+	for (uint8_t i = 0; i < 8; i++) {
+		setDaisyChainOutput((data & (1 << i))?DAISY_INPUT_FRAME_BIT1:DAISY_INPUT_FRAME_BIT0);
+		delayMicroseconds(DAISY_FRAME_BIT_HOLD_US);
+		setDaisyChainOutput(DAISY_INPUT_NOP);
+		delayMicroseconds(DAISY_FRAME_BIT_BREAK_US);
+	}
+
+	daisy_frame_next_byte++;
+	if (daisy_frame_next_byte == DAISY_FRAME_BYTES)
+		daisy_frame_next_byte = -1;
+}
+
+// takes over the changes of the leader's configuration received with its frame. Values the leader
+// did not change stay as they are, so a follower can still be configured by its own commands
+void receiveDaisyChainFrame() {
+	daisy_frame frame;
+	if (!daisy_frame_receiver.pop(frame))
+		return;
+
+	if (config.daisy_chain_ring) {
+		// the frame of the last node came back to the head of the ring, only its status is taken
+		daisy_chain_ring_nodes = (frame.node < UINT8_MAX)?(frame.node + 1):UINT8_MAX;
+		daisy_chain_ring_status = frame.status;
+		daisy_chain_ring_us = now_us;
+		return;
+	}
+
+	if ((frame.full_cycle_len_us != daisy_frame_last.full_cycle_len_us) &&
+		(frame.full_cycle_len_us >= 1000000000UL/MAX_IMAGE_FREQUENCY_MHZ) &&
+		(frame.full_cycle_len_us <= 1000000000UL/MIN_IMAGE_FREQUENCY_MHZ)) {
+		input_full_cycle_len_us = frame.full_cycle_len_us;
+		freqChange_from_leader = true;
+		freqChange_request = true;
+	}
+	if ((frame.light_pulse_duty_len_us != daisy_frame_last.light_pulse_duty_len_us) &&
+		(frame.light_pulse_duty_len_us >= MIN_DUTY_LEN_US) && (frame.light_pulse_duty_len_us <= MAX_DUTY_LEN_US)) {
+		input_light_pulse_duty_len_us = frame.light_pulse_duty_len_us;
+		freqChange_request = true;
+	}
+	if ((frame.flags ^ daisy_frame_last.flags) & DAISY_FRAME_FLAG_EXTERNAL_TRIGGER)
+		config.external_trigger_mode = (frame.flags & DAISY_FRAME_FLAG_EXTERNAL_TRIGGER);
+	daisy_frame_last = frame;
+
+	daisy_chain_node = (frame.node < UINT8_MAX)?(frame.node + 1):UINT8_MAX;
+	daisy_chain_upstream_status = frame.status;
+}
+
+// returns the number of nodes up to this one, or of the whole ring on its head, and the DAISY_NODE_* of each,
+// like Q3,1,1,3. Only the first DAISY_CHAIN_MAX_NODES nodes have a status
+void returnChainStatus() {
+	uint16_t status;
+	uint8_t nodes = knownChainNodes(status);
+
+	serial_out.print('Q');
+	serial_out.print(nodes);
+	for (uint8_t i = 0; (i < nodes) && (i < DAISY_CHAIN_MAX_NODES); i++) {
+		serial_out.print(',');
+		serial_out.print((status >> (i*DAISY_NODE_STATUS_BITS)) & ((1 << DAISY_NODE_STATUS_BITS) - 1));
+	}
+	serial_out.println();
+}
+
+// same as setDaisyChainOutput, but as events of the timeline. The clock OUT0 is a separate event
+// DAISY_CLOCK_DELAY_US after the data lines
+void scheduleDaisyChainOutput(unsigned long at_ticks, uint8_t data) {
+	timeline.addTrain(at_ticks, 0, 1, OUTPUT_DAISY1 | OUTPUT_DAISY2,
+					  ((data & 4)?OUTPUT_DAISY2:0) | ((data & 2)?OUTPUT_DAISY1:0));
+	timeline.addTrain(at_ticks + usToTicks(DAISY_CLOCK_DELAY_US), 0, 1, OUTPUT_DAISY0, (data & 1)?OUTPUT_DAISY0:0);
+}
+
+// [us] largest phase offset that keeps the last pulse of the cycle within the cycle. The pulses are
+// spread over the cycle, so the last one starts ceil(full/n) before the cycle's end. With an external
+// trigger, the last one starts one spacing before the predicted next trigger
+unsigned long maxPhaseOffset(const configuration_type& c = config) {
+	unsigned long last_pulse_lead_us = c.external_trigger_mode?c.lights_pulse_len_us:
+									   (c.full_cycle_len_us + c.no_of_strobes - 1)/c.no_of_strobes;
+	unsigned long pulse_len_us = max(c.light_pulse_duty_len_us, CAMERA_TRIGGER_LEN_US);
+	return (last_pulse_lead_us > pulse_len_us)?(last_pulse_lead_us - pulse_len_us):0;
+}
+
+unsigned long greatestCommonDivisor(unsigned long a, unsigned long b) {
+	while (b != 0) {
+		unsigned long r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+// true if the pulses of a sub-trigger channel of the configuration c fit into the dark gap after a light
+// pulse. Pulse k is k*divider*n/multiplier light pulses after the first one, so relative to its light pulse
+// it is at one of q = multiplier/gcd(divider*n, multiplier) phases, spaced evenly over the light pulse's
+// length. All of them plus the length of the sub-trigger pulse have to fit into the gap
+bool subTriggerFitsInDark(const configuration_type& c, uint8_t ch) {
+	const sub_trigger_config& sub = c.sub_triggers[ch];
+	unsigned long spacing_us = c.lights_pulse_len_us;
+	unsigned long dark_start_us = c.light_pulse_duty_len_us + LIGHTS_PULSE_OFF_DELAY;
+	unsigned long phases = sub.multiplier/greatestCommonDivisor((unsigned long)sub.divider*c.no_of_strobes, sub.multiplier);
+	unsigned long phases_spread_us = spacing_us - spacing_us/phases;
+	return (dark_start_us + phases_spread_us + sub.pulse_len_us + LIGHTS_PULSE_ON_DELAY <= spacing_us);
+}
+
+// places the pulses of a sub-trigger channel into the dark gap after a light pulse.
+// Returns false if they do not fit
+bool placeSubTrigger(uint8_t ch) {
+	sub_trigger_dark_offset_us[ch] = min(config.phase_offset_us, maxPhaseOffset()) + config.light_pulse_duty_len_us + LIGHTS_PULSE_OFF_DELAY;
+	sub_trigger_in_dark[ch] = subTriggerFitsInDark(config, ch);
+	return sub_trigger_in_dark[ch];
+}
+
+// solves the placement of all sub-trigger channels, called whenever the cycle changes.
+// Channels that do not fit run with their own offset. Returns false if any does not fit
+bool placeSubTriggers() {
+	bool all_in_dark = true;
+	for (uint8_t ch = 0; ch < SUB_TRIGGER_CHANNELS; ch++)
+		if (!placeSubTrigger(ch) && (config.sub_triggers[ch].pin != TIMELINE_NO_PIN))
+			all_in_dark = false;
+	return all_in_dark;
+}
+
+// trains compileCycle() adds at most: light pulses on/off and the lead pulses of the external trigger,
+// camera on/off, two daisy chain outputs of two trains each and two trains per sub-trigger channel.
+// When it runs, the lights, camera and daisy chain trains of the ending cycle are done, but its
+// sub-trigger pulses can still be running. So addTrain() always finds a free train
+#define CYCLE_MAX_TRAINS (4 + 2 + 2*2 + 2*SUB_TRIGGER_CHANNELS)
+static_assert(TIMELINE_MAX_TRAINS >= CYCLE_MAX_TRAINS + 2*SUB_TRIGGER_CHANNELS, "TIMELINE_MAX_TRAINS too small for the worst case cycle");
+
+// compiles all edges of the cycle starting at start_cycle_time_us into the timeline.
+// Called once per cycle right after the last pulse of the previous cycle went off
+void compileCycle() {
+	// the timeline works in ticks of the time base
+	unsigned long start_ticks = usToTicks(start_cycle_time_us);
+	unsigned long full_cycle_ticks = usToTicks(cycleLen());
+	// lights and camera of this station are shifted by the phase offset, as long as no pulse
+	// crosses the cycle boundary. The daisy chain keeps the unshifted cycle start as reference
+	unsigned long offset_ticks = usToTicks(min(config.phase_offset_us, maxPhaseOffset()));
+	unsigned long pulse_start_ticks = start_ticks + offset_ticks - usToTicks(CONTROLLINO_TIME_TO_GO_HIGH);
+	unsigned long pulse_end_ticks = start_ticks + offset_ticks + usToTicks(config.light_pulse_duty_len_us - CONTROLLINO_TIME_TO_GO_LOW);
+
+	if (config.external_trigger_mode) {
+		// the cycle starts with the trigger. The first pulses follow it, the lead pulses end
+		// right before the predicted next trigger
+		unsigned long spacing_ticks = usToTicks(config.lights_pulse_len_us);
+		uint16_t trailing_strobes = config.no_of_strobes - trigger_lead_strobes;
+		unsigned long lead_start_ticks = full_cycle_ticks - trigger_lead_strobes*spacing_ticks;
+		timeline.addTrain(pulse_start_ticks, spacing_ticks, trailing_strobes, OUTPUT_LIGHTS, OUTPUT_LIGHTS, MARKER_PULSE_ON);
+		timeline.addTrain(pulse_end_ticks, spacing_ticks, trailing_strobes, OUTPUT_LIGHTS, 0, MARKER_PULSE_OFF);
+		if (trigger_lead_strobes > 0) {
+			timeline.addTrain(pulse_start_ticks + lead_start_ticks, spacing_ticks, trigger_lead_strobes,
+							  OUTPUT_LIGHTS, OUTPUT_LIGHTS, MARKER_PULSE_ON);
+			timeline.addTrain(pulse_end_ticks + lead_start_ticks, spacing_ticks, trigger_lead_strobes,
+							  OUTPUT_LIGHTS, 0, MARKER_PULSE_OFF);
+		}
+	} else {
+		// lights_pulse_len_us is rounded down, so the pulses are spread over the full cycle
+		// to not have a longer gap at the end of the cycle
+		timeline.addSpreadTrain(pulse_start_ticks, full_cycle_ticks, cycleStrobes(),
+								OUTPUT_LIGHTS, OUTPUT_LIGHTS, MARKER_PULSE_ON);
+		timeline.addSpreadTrain(pulse_end_ticks, full_cycle_ticks, cycleStrobes(),
+								OUTPUT_LIGHTS, 0, MARKER_PULSE_OFF);
+	}
+	// the camera gets the trigger to take an image once the lights reached full brightness.
+	// If it has been triggered already (cycle restarted within the first pulse), only turn it off
+	if (camera_cycle && !image_capture_turned_on)
+		timeline.addTrain(pulse_start_ticks + usToTicks(LIGHTS_PULSE_ON_DELAY), 0, 1, OUTPUT_CAMERA, OUTPUT_CAMERA, MARKER_CAMERA_ON);
+	timeline.addTrain(start_ticks + offset_ticks + usToTicks(CAMERA_TRIGGER_LEN_US - CONTROLLINO_TIME_TO_GO_LOW), 0, 1, OUTPUT_CAMERA, 0);
+	if (!camera_cycle)
+		return;
+
+	// tell your slave to start the cycle at the end of the first pulse without offset,
+	// and reset the command with the second pulse to be prepared for setting it up next time
+	daisy_chain_cycle_start_ticks = start_ticks + usToTicks(config.light_pulse_duty_len_us - CONTROLLINO_TIME_TO_GO_LOW);
+	scheduleDaisyChainOutput(daisy_chain_cycle_start_ticks, DAISY_INPUT_CYCLE_START);
+	scheduleDaisyChainOutput(start_ticks + usToTicks(config.lights_pulse_len_us - CONTROLLINO_TIME_TO_GO_HIGH), DAISY_INPUT_NOP);
+
+	compileSubTriggers(start_ticks, full_cycle_ticks);
+}
+
+// drops the remaining schedule and starts over with the cycle at start_cycle_time_us
+void restartCycle() {
+#ifdef DO_HW_PULSE_ENGINE
+	pulse_engine.cancel();
+#endif
+	timeline.clear();
+	nth_strobe = 0;
+	pulse_state = false;
+	compileCycle();
+	timeline.feed();
+}
+
 // a function to compute abs(a-b) where a and b are unsigned long
 inline unsigned long absDiff(unsigned long a,unsigned long b) {
 	if (a>b) {
@@ -544,100 +1024,191 @@ inline unsigned long absDiff(unsigned long a,unsigned long b) {
 	}
 }
 
-// a function to update the current, above and below values from daisy_chain_cam_freq_cycle_times
-// we copy these values from the table to avoid indexing into the array all the time. Should be faster :)
-inline void daisyChainUpdateFreqValues() {
-	if (daisy_chain_camera_freq_index > 0) {
-		daisy_chain_camera_freq_below = daisy_chain_cam_freq_cycle_times[daisy_chain_camera_freq_index - 1];
+// starts measuring the hop latency, OUT0..2 need to be looped back to IN0..2 of this unit
+void startDaisyChainCalibration() {
+	daisy_chain_calibration_samples = DAISY_CHAIN_CALIBRATION_SAMPLES;
+	daisy_chain_calibration_sum_us = 0;
+	daisy_chain_echo_mode = true;
+}
+
+// sends one echo and measures its latency, once all are taken their average becomes the hop latency
+void runDaisyChainCalibration() {
+	setDaisyChainOutput(DAISY_INPUT_NOP);
+	delayMicroseconds(DAISY_CHAIN_ECHO_SETTLE_US);
+	daisy_chain_echo_received = false;
+	// same as the timeline sending CYCLE_START, the data lines go first and the clock follows
+	unsigned long sent_us = delayedMicros();
+	setDaisyChainOutput(DAISY_INPUT_CYCLE_START);
+	while (!daisy_chain_echo_received && ((delayedMicros() - sent_us) < DAISY_CHAIN_ECHO_TIMEOUT_US));
+	setDaisyChainOutput(DAISY_INPUT_NOP);
+
+	if (!daisy_chain_echo_received) {
+		daisy_chain_echo_mode = false;
+		daisy_chain_calibration_samples = 0;
+		printError(ErrorDaisyChainNoEcho);
+		return;
 	}
-	else {
-		daisy_chain_camera_freq_below = daisy_chain_cam_freq_cycle_times[0];
+	uint8_t sreg = SREG;
+	cli();
+	daisy_chain_calibration_sum_us += daisy_chain_echo_us - sent_us;
+	SREG = sreg;
+
+	daisy_chain_calibration_samples--;
+	if (daisy_chain_calibration_samples == 0) {
+		daisy_chain_echo_mode = false;
+		config.daisy_chain_hop_latency_us = daisy_chain_calibration_sum_us/DAISY_CHAIN_CALIBRATION_SAMPLES;
+		delayedWriteConfiguration();
+		serial_out.print(F("hop latency "));
+		serial_out.print(config.daisy_chain_hop_latency_us);
+		serial_out.println(F("us"));
+		serial_out.println(ReturnOk);
 	}
-	daisy_chain_camera_freq = daisy_chain_cam_freq_cycle_times[daisy_chain_camera_freq_index];
-	if (daisy_chain_camera_freq_index < daisy_chain_number_of_cam_freq - 1) {
-		daisy_chain_camera_freq_above = daisy_chain_cam_freq_cycle_times[daisy_chain_camera_freq_index + 1];
+}
+
+// runs the phase lock with the last CYCLE_START of the leader. Small phases are corrected by the start
+// of the next cycle, the cycle length follows the leader's period at the next cycle boundary
+void daisyChainTrackLeader() {
+	uint8_t sreg = SREG;
+	cli();
+	unsigned long leader_start_us = daisy_chain_start_us;
+	SREG = sreg;
+
+	// the leader sent CYCLE_START at the end of its first pulse, and it took the hop latency to reach us.
+	// Until its frame told us, the leader's duty is assumed to be ours
+	unsigned long leader_duty_len_us = (daisy_frame_last.light_pulse_duty_len_us != 0)?daisy_frame_last.light_pulse_duty_len_us:config.light_pulse_duty_len_us;
+	leader_start_us -= config.daisy_chain_hop_latency_us + leader_duty_len_us - CONTROLLINO_TIME_TO_GO_LOW;
+
+	// phase to our own cycle start nearest to the leader's, that has been set at the last cycle boundary
+	// or will be set at the next one
+	long phase_us = (long)(leader_start_us - start_cycle_time_us);
+	if (phase_us > (long)(config.full_cycle_len_us/2))
+		phase_us -= config.full_cycle_len_us;
+	else if (phase_us < -(long)(config.full_cycle_len_us/2))
+		phase_us += config.full_cycle_len_us;
+
+	phase_lock.update(leader_start_us, phase_us, config.lights_pulse_len_us >> 1);
+	if (!phase_lock.locked())
+		return;
+
+	unsigned long period_us = phase_lock.period();
+	if ((period_us < 1000000000UL/MAX_IMAGE_FREQUENCY_MHZ) || (period_us > 1000000000UL/MIN_IMAGE_FREQUENCY_MHZ)) {
+		// missed a CYCLE_START or the leader is out of range, start over
+		phase_lock.reset();
+		return;
 	}
-	else {
-		daisy_chain_camera_freq_above = daisy_chain_cam_freq_cycle_times[daisy_chain_number_of_cam_freq - 1];
+	if (absDiff(period_us, config.full_cycle_len_us) > DAISY_CHAIN_PERIOD_TOLERANCE_US) {
+		input_full_cycle_len_us = period_us;
+		freqChange_request = true;
+		freqChange_from_leader = true;
 	}
 }
 
-// given a cycle time (the camera freq in ns), find the nearest in the table of supported frequencies
-// for daisy chaining auto sync. Once found, update the stored current, above and below values
-void daisyChainFindCameraFreq(unsigned long estimated_cycle_time) {
-	unsigned long best_err = daisy_chain_cam_freq_cycle_times[0];
-	daisy_chain_camera_freq_index = 0;
-
-	for (uint8_t i = 0; i < daisy_chain_number_of_cam_freq; i++) {
-		unsigned long err = absDiff(daisy_chain_cam_freq_cycle_times[i], estimated_cycle_time);
-		if (err < best_err) {
-			daisy_chain_camera_freq_index = i;
-			best_err = err;
-		}
+// filters the period between two external triggers, taken from the time stamps of the interrupt.
+// A trigger that comes far off the period restarts the filter, e.g. after the PLC paused
+void measureExternalTrigger()
+{
+	uint8_t sreg = SREG;
+	cli();
+	unsigned long trigger_us = daisy_chain_start_us;
+	SREG = sreg;
+
+	if (prev_triggered_cycle_time_us != 0) {
+		unsigned long interval_us = trigger_us - prev_triggered_cycle_time_us;
+		if (interval_us > 1000000000UL/MIN_IMAGE_FREQUENCY_MHZ)
+			external_trigger_period_us = 0;
+		else if ((interval_us > 2*external_trigger_period_us) || (interval_us < external_trigger_period_us/2))
+			external_trigger_period_us = interval_us;
+		else
+			external_trigger_period_us += (long)(interval_us - external_trigger_period_us)/8;
 	}
-	daisyChainUpdateFreqValues();
-}
-
-void calculateFreqMismatch() {
-  if ((prev_triggered_cycle_time_us > 0) && (start_cycle_time_us > prev_triggered_cycle_time_us)) {
-		cycle_time_estimate = start_cycle_time_us - prev_triggered_cycle_time_us;
-    unsigned long cycle_err = absDiff(daisy_chain_camera_freq, cycle_time_estimate);
-
-	// up to 1000 us of drift is considered "within expected range". Above 1000 we start to track drift
-	constexpr int MAX_DRIFT_us = 1000;
-	if (cycle_err > MAX_DRIFT_us) {
-	  // check for drift towards lower camera frequencies. We can only do this if we are not already
-	  // at index zero, our lowest supported frequency.
-	  if (daisy_chain_camera_freq_index > 0) {
-		unsigned long cycle_err_below = absDiff(daisy_chain_camera_freq_below, cycle_time_estimate);
-		if (cycle_err_below < cycle_err) {
-		  daisy_chain_cycle_err--;
-		  if (daisy_chain_cycle_err == -5) {
-		    // we got five cycles drifting towards a lower frequency. Update our camera frequency
-			// to the previous frequency, slowing down our cycle time.
-			daisy_chain_camera_freq_index--;
-			daisyChainUpdateFreqValues();
-			input_full_cycle_len_us = daisy_chain_camera_freq;
-			daisy_chain_cycle_err = 0;
-		  }
-		}
-	  }
-	  // check for drift towards higher camera frequencies. We can only do this if we are not already
-	  // at index (daisy_chain_number_of_cam_freq-1), our highest supported frequency.
-	  if (daisy_chain_camera_freq_index < daisy_chain_number_of_cam_freq - 1) {
-		unsigned long cycle_err_above = absDiff(daisy_chain_camera_freq_above, cycle_time_estimate);
-		if (cycle_err_above < cycle_err) {
-		  daisy_chain_cycle_err++;
-		  if (daisy_chain_cycle_err == 5) {
-			// we got five cycles drifting towards a higher frequency. Update our camera frequency
-			// to the next frequency, speeding up our cycle time.
-			daisy_chain_camera_freq_index++;
-			daisyChainUpdateFreqValues();
-			input_full_cycle_len_us = daisy_chain_camera_freq;
-			daisy_chain_cycle_err = 0;
-		  }
-		}
-      }
-    }
-  }
+	prev_triggered_cycle_time_us = trigger_us;
+	cycle_time_estimate = external_trigger_period_us;
 }
 
+// compiles the strobe plan of an external trigger into cycle lengths. The cycle lasts until the
+// predicted next trigger and ends with the lead pulses. Without a prediction, the cycle ends with
+// the last pulse after the trigger. Pulses that do not fit into the period are dropped, lead pulses first
 void computeCycleLengthsExternalTrigger()
 {
-  config.full_cycle_len_us = external_trigger_period_us;
-  // reset start time of measurement, so first cycle is not measured
-  cycle_time_estimate = start_cycle_time_us - prev_triggered_cycle_time_us;
+	config.lights_pulse_len_us = config.trigger_strobe_spacing_us;
+	config.light_pulse_duty_len_us = config.lights_pulse_len_us/MAX_DUTY_RATIO;
+
+	uint16_t trailing_strobes = config.trigger_strobe_count - config.trigger_lead_strobes;
+	if (external_trigger_period_us == 0) {
+		trigger_lead_strobes = 0;
+		config.full_cycle_len_us = trailing_strobes*config.lights_pulse_len_us;
+	} else {
+		unsigned long max_strobes = max(1UL, external_trigger_period_us/config.lights_pulse_len_us);
+		trailing_strobes = min((unsigned long)trailing_strobes, max_strobes);
+		trigger_lead_strobes = min((unsigned long)config.trigger_lead_strobes, max_strobes - trailing_strobes);
+		config.full_cycle_len_us = external_trigger_period_us;
+	}
+	config.no_of_strobes = trailing_strobes + trigger_lead_strobes;
+	placeSubTriggers();
 
-  config.no_of_strobes = config.full_cycle_len_us/config.lights_pulse_len_us;	// compute the number of strobes per cycle and convert to int
-  config.lights_pulse_len_us = config.full_cycle_len_us/config.no_of_strobes; // now adapt the pulse cycle length to get an equal distribution of pulses
-  config.light_pulse_duty_len_us = config.lights_pulse_len_us/MAX_DUTY_RATIO;
+	measure_pulse_cycle_duration_us = config.lights_pulse_len_us;
+	measure_pulse_duty_duration_us = config.light_pulse_duty_len_us;
+}
 
-  //override the number of strobes to 3
-  //With external trigger it is impossible to remove the flicker so just give up
-  config.no_of_strobes = 3;
+/***************************/
+/* Telemetry               */
+/***************************/
+
+// After every camera cycle, the values of the cycle are latched. If streaming is on, they are sent
+// as BINARY_TELEMETRY frame in the slack (see binaryProtocol.h). The host gets them pushed instead of
+// polling s, and can correlate them with its images by the number of the cycle
+
+#define TELEMETRY_FRAME_LEN 44					// [bytes] max length of a telemetry frame, with SLIP escapes
+
+struct telemetry_type {
+	unsigned long cycle;						// number of the camera cycle since start
+	unsigned long trigger_us;					// [us] time the camera trigger went out
+	unsigned long exposure_us;					// [us] 0 if no image has been taken
+	uint16_t pulse_period_us;					// [us] measured, average
+	uint16_t pulse_duty_us;						// [us] measured, average
+	uint16_t flags;								// BINARY_TELEMETRY_*
+} telemetry;
+
+bool telemetry_on = false;						// if true, a frame is sent after every camera cycle
+bool telemetry_pending = false;					// the frame of the last camera cycle waits for the slack
+unsigned long telemetry_cycle = 0;				// camera cycles since start
+uint8_t telemetry_edges_lost = 0;				// counters at the last frame, flags tell if they changed since
+uint16_t telemetry_overruns = 0;
+uint16_t telemetry_stalls = 0;
+
+// called at the end of a camera cycle, once it is known whether the camera took an image
+void latchTelemetry() {
+	telemetry.cycle = telemetry_cycle++;
+	telemetry.trigger_us = image_trigger_us;
+	telemetry.exposure_us = camera_works?camera_exposure_last_us:0;
+	telemetry.pulse_period_us = min(measure_pulse_cycle_duration_us, (unsigned long)UINT16_MAX);
+	telemetry.pulse_duty_us = min(measure_pulse_duty_duration_us, (unsigned long)UINT16_MAX);
+	telemetry.flags = (camera_works?BINARY_TELEMETRY_IMAGE_TAKEN:0) |
+					  (power_on?BINARY_TELEMETRY_POWER_ON:0) |
+					  (error_led_mode?BINARY_TELEMETRY_ERROR_LED:0) |
+					  (phase_lock.locked()?BINARY_TELEMETRY_LOCKED:0) |
+					  (daisy_chain_holdover?BINARY_TELEMETRY_HOLDOVER:0) |
+					  ((camera_strobe_edges.lost() != telemetry_edges_lost)?BINARY_TELEMETRY_EDGES_LOST:0) |
+					  ((scheduler.overruns() != telemetry_overruns)?BINARY_TELEMETRY_OVERRUN:0) |
+					  ((serial_out.stalls() != telemetry_stalls)?BINARY_TELEMETRY_STALL:0);
+	telemetry_edges_lost = camera_strobe_edges.lost();
+	telemetry_overruns = scheduler.overruns();
+	telemetry_stalls = serial_out.stalls();
+	camera_exposure_last_us = 0;
+	// a frame not sent yet is overwritten, the host sees the gap in the cycle numbers
+	telemetry_pending = telemetry_on;
+}
 
-  measure_pulse_cycle_duration_us = config.lights_pulse_len_us;
-  measure_pulse_duty_duration_us = config.light_pulse_duty_len_us;
+void sendTelemetry() {
+	telemetry_pending = false;
+	binary_protocol.beginReply(BINARY_TELEMETRY);
+	binary_protocol.writeValue(telemetry.cycle, 4);
+	binary_protocol.writeValue(telemetry.trigger_us, 4);
+	binary_protocol.writeValue(telemetry.exposure_us, 4);
+	binary_protocol.writeValue(telemetry.pulse_period_us, 2);
+	binary_protocol.writeValue(telemetry.pulse_duty_us, 2);
+	binary_protocol.writeValue(telemetry.flags, 2);
+	binary_protocol.endReply();
 }
 
 void handleCameraStrobeLatch()
@@ -648,6 +1219,7 @@ void handleCameraStrobeLatch()
       } else {
         camera_works = false;
       }
+      latchTelemetry();
       // next cycle sets the trigger again
       image_capture_turned_on = false;
       image_start_latch = false;
@@ -655,38 +1227,83 @@ void handleCameraStrobeLatch()
     }
 }
 
+// called when the encoder reached the position of the next image, starts the cycle as soon as the
+// lights had their off time after the last pulse. The belt took interval_us for the last n counts,
+// the cycle gets this length and the strobes are spread over it. They keep their length, so the
+// duty stays within its limits
+void handleEncoderTrigger(unsigned long interval_us) {
+	if (interval_us != 0)
+		encoder_period_us = constrain(interval_us, 1000000000UL/MAX_IMAGE_FREQUENCY_MHZ, 1000000000UL/MIN_IMAGE_FREQUENCY_MHZ);
+	else if (encoder_period_us == 0)
+		encoder_period_us = config.full_cycle_len_us;
+	encoder_no_of_strobes = max(1UL, encoder_period_us/config.lights_pulse_len_us);
+
+	// a cycle cut short by the trigger has not checked its image yet
+	handleCameraStrobeLatch();
+	camera_cycle = true;
+	start_cycle_time_us = now_us + 2*CONTROLLINO_TIME_TO_GO_HIGH;
+	unsigned long earliest_start_us = last_pulse_off_us + (config.lights_pulse_len_us - config.light_pulse_duty_len_us) +
+									  CONTROLLINO_TIME_TO_GO_HIGH;
+	if ((long)(earliest_start_us - start_cycle_time_us) > 0)
+		start_cycle_time_us = earliest_start_us;
+	restartCycle();
+}
+
+// called by loop() before the cycle restarts with the external trigger
 inline void handleIN0TriggerEvent()
 {
-	computeCycleLengthsExternalTrigger();
-
-	//normally we do this on the last strobe but this rarely occurs
-	// in external trigger mode. So we do it on every interrupt flag.
+	//normally we do this on the last strobe but the trigger might cut the cycle short.
+	// So we do it on every trigger, before the next image is taken
 	handleCameraStrobeLatch();
 
+	measureExternalTrigger();
+	computeCycleLengthsExternalTrigger();
 }
 
-//This handles IN0 interrupt for external trigger or daisy chain mode
+//This handles IN0 interrupt in daisy chain mode, the external trigger is handled by the restart of the cycle
 void pollIN0InterruptEvent()
 {
 	if(has_cycle_start_triggered){
-		 if(config.external_trigger_mode) {
-				handleIN0TriggerEvent();
-			}
-      //Daisy chain mode
-		  else {
-        // this section attempts to check if the leader unit is running at a different cycle time (camera frequency)
-        // and if so attempts to adjust this unit to match the leader
-        //Only run if we had an interrupt triggered
-        calculateFreqMismatch();
-    	}
-    has_cycle_start_triggered = false;
-    //Keep this saved for the next cycle
-    prev_triggered_cycle_time_us = start_cycle_time_us;
-  }
+		if(!config.external_trigger_mode) {
+			// lock the cycle of this unit to the cycle of the leader
+			daisyChainTrackLeader();
+		}
+		has_cycle_start_triggered = false;
+	}
 }
 
 // callback from interrupt pin PIN_DAISY_IN0, acts as clock
 void daisyChainIn() {
+	unsigned long in_us = delayedMicros();
+	if (daisy_chain_echo_mode) {
+		// our own output looped back while measuring the hop latency
+		daisy_chain_echo_us = in_us;
+		daisy_chain_echo_received = true;
+		return;
+	}
+
+	// a spike on the cable is gone after a few us, a real edge stays HIGH. The level has to be known
+	// before the leader's frame toggles IN0 again, so it is sampled here. The samples take ~3.5us with
+	// interrupts enabled, so the compare interrupt of the pulse engine outputs the timeline's edges on
+	// time. Without that, an edge would come up to ~5us late, still below PULSE_ENGINE_MIN_LEAD_US.
+	// This interrupt is masked meanwhile, so a bouncing edge does not nest
+	EIMSK &= ~_BV(digitalPinToInterrupt(PIN_DAISY_IN0));
+	sei();
+	uint8_t in0_high_samples = 0;
+	for (uint8_t i = 0; i < IN0_GLITCH_SAMPLES; i++) {
+		delayMicroseconds(IN0_GLITCH_SAMPLE_US);
+		if (digitalReadFast(PIN_DAISY_IN0))
+			in0_high_samples++;
+	}
+	cli();
+	// edges while masked set the flag anyway, they must not fire right after this interrupt
+	EIFR = _BV(digitalPinToInterrupt(PIN_DAISY_IN0));
+	EIMSK |= _BV(digitalPinToInterrupt(PIN_DAISY_IN0));
+	if (in0_high_samples <= IN0_GLITCH_SAMPLES/2) {
+		in0_glitches++;
+		return;
+	}
+
 	bool in0 = true; //On rising edge in0 is always true
 	bool in1 = digitalReadFast(PIN_DAISY_IN1);
 	bool in2 = digitalReadFast(PIN_DAISY_IN2);
@@ -694,15 +1311,29 @@ void daisyChainIn() {
 
 	switch (daisyChainInputData) {
 	case DAISY_INPUT_CYCLE_START:
-		start_cycle_time_us = now_us;
-
-		nth_strobe = 0;
-		pulse_state = false;
+		if (config.daisy_chain_ring) {
+			// our own CYCLE_START came back from the last node of the ring, its frame follows
+			daisy_frame_receiver.reset();
+			break;
+		}
+		if (in_us - daisy_chain_start_us < config.min_trigger_interval_us) {
+			in0_early_cycle_starts++;
+			break;
+		}
+		daisy_chain_start_us = in_us;
 		daisy_chain_slave = true;
-
-		next_pulse_start_time = start_cycle_time_us - CONTROLLINO_TIME_TO_GO_HIGH;
-		next_pulse_end_time = next_pulse_start_time + config.light_pulse_duty_len_us - CONTROLLINO_TIME_TO_GO_LOW;
-		next_camera_off_time = next_pulse_start_time + CAMERA_TRIGGER_LEN_US - CONTROLLINO_TIME_TO_GO_LOW;
+		// the leader's frame follows
+		daisy_frame_receiver.reset();
+
+		// once locked to the leader, the phase lock keeps the cycle aligned without restarting it
+		if (!phase_lock.tracking() || config.external_trigger_mode) {
+			start_cycle_time_us = daisy_chain_start_us;
+			// the schedule is recompiled by loop(), until then nothing of the old schedule is output
+			cycle_restart_requested = true;
+#ifdef DO_HW_PULSE_ENGINE
+			pulse_engine.cancel();
+#endif
+		}
 
 		if (!power_on) {
 			power_on = true;
@@ -715,13 +1346,17 @@ void daisyChainIn() {
 
 		break;
 	case DAISY_INPUT_POWER_OFF:
-		if (power_on) {
+		// on the head of a ring, this is our own command coming back
+		if (power_on && !config.daisy_chain_ring) {
 			input_power_off = true;
 			// tell GODS to turn on power with next status call
 			propagation_mode = PROPAGATE_POWER_OFF;
 		}
 
 		break;
+	case DAISY_INPUT_FRAME_BIT0:
+	case DAISY_INPUT_FRAME_BIT1:
+		daisy_frame_receiver.push(daisyChainInputData == DAISY_INPUT_FRAME_BIT1);
 		break;
 	default:
 #ifdef DEBUG
@@ -739,153 +1374,351 @@ void daisyChainIn() {
 }
 
 
-void printConfiguration() {
-	Serial.println(F("Configuration"));
-
-	Serial.print(F("	len between two images  : "));
-	Serial.print(config.full_cycle_len_us);
-	Serial.print(F("[us]="));
-	Serial.print(1000000UL/config.full_cycle_len_us);
-	Serial.println(F("Hz"));
-
-	Serial.print(F("	len of light pulse      : "));
-	Serial.print(config.lights_pulse_len_us);
-	Serial.print(F("[us]="));
-	Serial.print(1000000UL/config.lights_pulse_len_us);
-	Serial.println(F("Hz"));
-
-	Serial.print(F("	duty len of light pulse : "));
-	Serial.print(config.light_pulse_duty_len_us);
-	Serial.println(F("[us]"));
-	Serial.print(F("	number of strobes/cycle : "));
-	Serial.println(config.no_of_strobes);
-
-	Serial.print(F("	camera works            : "));
-	Serial.println(camera_works);
+// prints section no of the configuration, returns false if there is none
+static_assert(SUB_TRIGGER_CHANNELS == 3, "printConfiguration() has a section per sub-trigger channel");
+bool printConfiguration(uint8_t section) {
+	switch (section) {
+		case 0:
+			serial_out.println(F("Configuration"));
+
+			serial_out.print(F("	len between two images  : "));
+			serial_out.print(config.full_cycle_len_us);
+			serial_out.print(F("[us]="));
+			printFrequency(config.full_cycle_len_us);
+			serial_out.println(F("Hz"));
+			break;
+
+		case 1:
+			serial_out.print(F("	len of light pulse      : "));
+			serial_out.print(config.lights_pulse_len_us);
+			serial_out.print(F("[us]="));
+			serial_out.print(1000000UL/config.lights_pulse_len_us);
+			serial_out.println(F("Hz"));
+
+			serial_out.print(F("	duty len of light pulse : "));
+			serial_out.print(config.light_pulse_duty_len_us);
+			serial_out.println(F("[us]"));
+			break;
+
+		case 2:
+			serial_out.print(F("	number of strobes/cycle : "));
+			serial_out.println(config.no_of_strobes);
+
+			serial_out.print(F("	camera works            : "));
+			serial_out.println(camera_works);
+
+			serial_out.print(F("	power_on                : "));
+			serial_out.println(power_on);
+			break;
+
+		case 3:
+			serial_out.print(F("	fan_on                  : "));
+			serial_out.println(fan_mode);
+
+			serial_out.print(F("	propagation_mode        : "));
+			serial_out.println(propagation_mode);
+
+			serial_out.print(F("	error led on            : "));
+			serial_out.println(error_led_mode);
+			break;
+
+		case 4:
+			serial_out.print(F("	auto strobe on          : "));
+			serial_out.println(config.auto_mode_on);
+
+			serial_out.print(F("	EEPROM(mem_bank_address="));
+			serial_out.print(eeprom_master_block.mem_bank_address);
+			serial_out.print(F(", write_counter="));
+			serial_out.print(config.write_counter);
+			serial_out.println(F(")"));
+			break;
+
+		case 5:
+			serial_out.print(F("	daisy chain locked      : "));
+			serial_out.println(phase_lock.locked());
+
+			serial_out.print(F("	daisy chain holdover    : "));
+			serial_out.println(daisy_chain_holdover);
+
+			serial_out.print(F("	daisy chain ring head   : "));
+			serial_out.println(config.daisy_chain_ring);
+			break;
+
+		case 6:
+			serial_out.print(F("	daisy chain period      : "));
+			serial_out.print(phase_lock.period());
+			serial_out.println(F("[us]"));
+
+			serial_out.print(F("	daisy chain CRC errors  : "));
+			serial_out.println(daisy_frame_receiver.crcErrors());
+			break;
+
+		case 7:
+			serial_out.print(F("	IN0 glitches rejected   : "));
+			serial_out.println(in0_glitches);
+			serial_out.print(F("	IN0 early starts rejected: "));
+			serial_out.println(in0_early_cycle_starts);
+			break;
+
+		case 8:
+			serial_out.print(F("	min trigger interval    : "));
+			serial_out.print(config.min_trigger_interval_us);
+			serial_out.println(F("[us]"));
+
+			serial_out.print(F("	daisy chain node        : "));
+			serial_out.println(daisy_chain_node);
+			break;
+
+		case 9:
+			serial_out.print(F("	daisy chain hop latency : "));
+			serial_out.print(config.daisy_chain_hop_latency_us);
+			serial_out.println(F("[us]"));
+			break;
+
+		case 10:
+			serial_out.print(F("	phase offset            : "));
+			serial_out.print(config.phase_offset_us);
+			serial_out.print(F("[us] (max "));
+			serial_out.print(maxPhaseOffset());
+			serial_out.println(F("[us])"));
+			break;
+
+		case 11:
+			serial_out.print(F("	External trigger mode: "));
+			serial_out.println(config.external_trigger_mode);
+
+			serial_out.print(F("	External trigger period: "));
+			serial_out.println(external_trigger_period_us);
+			break;
+
+		case 12:
+			serial_out.print(F("	External trigger plan   : "));
+			serial_out.print(config.trigger_strobe_count);
+			serial_out.print(F(" pulses every "));
+			serial_out.print(config.trigger_strobe_spacing_us);
+			serial_out.print(F("[us], "));
+			serial_out.print(config.trigger_lead_strobes);
+			serial_out.println(F(" before the trigger"));
+			break;
+
+		case 13:
+			serial_out.print(F("	sub-triggers interleaved: "));
+			serial_out.println(config.sub_trigger_interleaved);
+			break;
+
+		case 14:
+		case 15:
+		case 16: {
+			// one section per sub-trigger channel
+			uint8_t ch = section - 14;
+			const sub_trigger_config& sub = config.sub_triggers[ch];
+			serial_out.print(F("	sub-trigger "));
+			serial_out.print(ch);
+			serial_out.print(F("           : "));
+			if (sub.pin == TIMELINE_NO_PIN) {
+				serial_out.println(F("off"));
+				break;
+			}
+			serial_out.print(F("pin "));
+			serial_out.print(sub.pin);
+			serial_out.print(F(", "));
+			serial_out.print(sub.multiplier);
+			serial_out.print(F(" pulses per "));
+			serial_out.print(sub.divider);
+			serial_out.print(F(" images, "));
+			serial_out.print(sub.pulse_len_us);
+			serial_out.print(F("[us] at +"));
+			serial_out.print(sub.offset_us);
+			serial_out.print(F("[us]"));
+			if (config.sub_trigger_interleaved && sub_trigger_in_dark[ch]) {
+				serial_out.print(F(", in the dark at +"));
+				serial_out.print(sub_trigger_dark_offset_us[ch]);
+				serial_out.print(F("[us]"));
+			}
+			serial_out.println();
+			break;
+		}
 
-	Serial.print(F("	power_on                : "));
-	Serial.println(power_on);
+		case 17:
+			serial_out.print(F("	encoder counts/image    : "));
+			serial_out.println(config.encoder_counts_per_image);
+			serial_out.print(F("	encoder position        : "));
+			serial_out.println(encoder.position());
+			break;
 
-	Serial.print(F("	fan_on                  : "));
-	Serial.println(fan_mode);
+		case 18:
+			serial_out.print(F(" nth_strobe: "));
+			serial_out.println(nth_strobe);
 
-	Serial.print(F("	propagation_mode        : "));
-	Serial.println(propagation_mode);
+			serial_out.println();
+			break;
 
-	Serial.print(F("	error led on            : "));
-	Serial.println(error_led_mode);
+		default:
+			return false;
+	}
+	return true;
+}
 
-	Serial.print(F("	auto strobe on          : "));
-	Serial.println(config.auto_mode_on);
+// the help page is long, so it is printed section by section, each when the serial output
+// has room for it. Otherwise the page would fill the output and stall loop() for a few 100ms
+#define REPORT_SECTION_LEN 120					// max characters of a section of the help page
+
+bool printHelpHeader(uint8_t section) {
+	switch (section) {
+		case 0: {
+			unsigned long seconds = millis()/1000;
+			unsigned hours = seconds / 3600;
+			unsigned minutes = (seconds - hours*3600)/60;
+			seconds = seconds - hours*3600 - minutes*60;
+			serial_out.print(F("Camera/Lighting Synchronization (1c1) V"));
+			serial_out.println(VERSION);
+			serial_out.print("uptime ");
+			serial_out.print(hours);
+			serial_out.print("h ");
+			serial_out.print(minutes);
+			serial_out.print("m ");
+			serial_out.print(seconds);
+			serial_out.println("s ");
+			break;
+		}
 
-	Serial.print(F("	EEPROM(mem_bank_address="));
-	Serial.print(eeprom_master_block.mem_bank_address);
-	Serial.print(F(", write_counter="));
-	Serial.print(config.write_counter);
-	Serial.println(F(")"));
+		case 1:
+			serial_out.print(F("Strobing Ctrl/Greyparrot.AI/Jochen Alt V"));
+			serial_out.print(VERSION);
 
-	Serial.print(F("	daisy chain freq index  : "));
-	Serial.println(daisy_chain_camera_freq_index);
+			#ifdef DEBUG
+			serial_out.println("D");
+			#else
+			serial_out.println("R");
+			#endif
 
-	Serial.print(F("	daisy chain freq value  : "));
-	Serial.println(daisy_chain_camera_freq);
+			serial_out.println();
+			break;
 
-	Serial.print(F("	External trigger mode: "));
-	Serial.println(config.external_trigger_mode);
+		default:
+			return false;
+	}
+	return true;
+}
 
-	Serial.print(F("	External trigger period: "));
-	Serial.println(external_trigger_period_us);
+bool printCommands(uint8_t section) {
+	switch (section) {
+		case 0:
+			serial_out.println(F("Help"));
+			serial_out.println(F("	h         help"));
+			serial_out.println(F("	r         restart controller"));
+			break;
+		case 1:
+			serial_out.println(F("	e         save to EEPROM"));
+			serial_out.println(F("	s         return config string"));
+			break;
+		case 2:
+			serial_out.println(F("	q         return status of the daisy chain up to this node, of all on the head of a ring"));
+			break;
+		case 3:
+			serial_out.println(F("	0         reset to factory settings"));
+			serial_out.println(F("	n/N       error LED on/off"));
+			serial_out.println(F("	v/V       fan on/off"));
+			break;
+
+		case 4:
+			serial_out.println(F("	d/D       debugging mode on/off"));
+			serial_out.println(F("	a/A       auto calibration mode"));
+
+			serial_out.println(F("	p/P       power on/off"));
+			break;
+		case 5:
+			serial_out.println(F("	f<Hz><CR> set frequency, like f7.5"));
+			serial_out.println(F("	l<us><CR> length of strobing pulse"));
+			serial_out.println(F("	b<no><CR> propagation mode"));
+			break;
+		case 6:  serial_out.println(F("	k[<us>]<CR> measure daisy chain hop latency with OUT looped back to IN, or set it")); break;
+		case 7:  serial_out.println(F("	o<us><CR> phase offset of pulses and camera to the cycle start")); break;
+		case 8:  serial_out.println(F("	g<us><CR> min interval between two cycle starts on IN0, earlier ones are rejected")); break;
+		case 9:  serial_out.println(F("	t/T 	  Enable/Disable external trigger mode")); break;
+		case 10: serial_out.println(F("	x<no>,<us>,<no><CR> external trigger plan: pulses, their spacing, pulses before the trigger")); break;
+		case 11: serial_out.println(F("	u<ch>,<pin>,<no>,<no>,<us>,<us><CR> sub-trigger: pin (0 off), pulses per images, length, offset")); break;
+		case 12: serial_out.println(F("	i/I       sub-triggers interleaved with the light pulses on/off")); break;
+		case 13: serial_out.println(F("	c<no><CR> encoder counts per image, 0 turns encoder mode off")); break;
+		case 14: serial_out.println(F("	<0xC0>    starts a binary frame of a host, see binaryProtocol.h")); break;
+		case 15: serial_out.println(F("	m/M       binary telemetry frame after every camera cycle on/off")); break;
+		case 16: serial_out.println(F("	S<cmd>;<cmd><CR> f l c x u g o k a/A t/T i/I together at the next cycle, like Sf7.5;l1200")); break;
+		case 17: serial_out.println(F("	w/W       head of a ring, the last node's OUT0..2 wired back to IN0..2, on/off")); break;
+		default:
+			return false;
+	}
+	return true;
+}
 
-	Serial.print(F(" nth_strobe: "));
-	Serial.println(nth_strobe);
+// parts of the help page in their order
+typedef bool (*report_function)(uint8_t section);	// prints a section, returns false if there is none
+const report_function help_page[] = { printHelpHeader, printConfiguration, printMeasurements, printCommands };
+const uint8_t help_page_parts = sizeof(help_page)/sizeof(help_page[0]);
+int8_t help_part = -1;							// part of the help page being printed, -1 if none
+uint8_t help_section = 0;						// next section of help_part
 
-	Serial.println();
+// starts printing the help page
+void printHelp() {
+	help_part = 0;
+	help_section = 0;
 }
 
-void printHelp() {
-	unsigned long seconds = millis()/1000;
-	unsigned hours = seconds / 3600;
-	unsigned minutes = (seconds - hours*3600)/60;
-	seconds = seconds - hours*3600 - minutes*60;
-	Serial.print(F("Camera/Lighting Synchronization (1c1) V"));
-	Serial.println(VERSION);
-	Serial.print("uptime ");
-	Serial.print(hours);
-	Serial.print("h ");
-	Serial.print(minutes);
-	Serial.print("m ");
-	Serial.print(seconds);
-	Serial.println("s ");
-
-	Serial.print(F("Strobing Ctrl/Greyparrot.AI/Jochen Alt V"));
-	Serial.print(VERSION);
-
-	#ifdef DEBUG
-	Serial.println("D");
-	#else
-	Serial.println("R");
-	#endif
-
-	Serial.println();
-
-	printConfiguration();
-	printMeasurements();
-
-	Serial.println(F("Help"));
-	Serial.println(F("	h         help"));
-	Serial.println(F("	r         restart controller"));
-	Serial.println(F("	e         save to EEPROM"));
-	Serial.println(F("	s         return config string"));
-	Serial.println(F("	S         set configuration"));
-	Serial.println(F("	0         reset to factory settings"));
-	Serial.println(F("	n/N       error LED on/off"));
-	Serial.println(F("	v/V       fan on/off"));
-
-	Serial.println(F("	d/D       debugging mode on/off"));
-	Serial.println(F("	a/A       auto calibration mode"));
-
-	Serial.println(F("	p/P       power on/off"));
-	Serial.println(F("	f<Hz><CR> set frequency"));
-	Serial.println(F("	l<us><CR> length of strobing pulse"));
-	Serial.println(F("	b<no><CR> propagation mode"));
-	Serial.println(F("	t/T 	  Enable/Disable external trigger mode"));
+// prints the next section of the help page
+void printHelpSection() {
+	while (!help_page[help_part](help_section)) {
+		help_section = 0;
+		help_part++;
+		if (help_part == help_page_parts) {
+			help_part = -1;
+			return;
+		}
+	}
+	help_section++;
 }
 
 // called by the interrupt triggered by the camera's STROBE_OUT
-// sets a flag to indicate that the camera worked
+// only records the edge, handleCameraStrobeEdges() sets the flags indicating that the camera worked
 void cameraStrobeOut() {
-	bool strobe_out = digitalReadFast(PIN_CAMERA_STROBE_OUT);
+	// take the time right here instead of using now_us of loop(), evaluation happens in loop()
+	camera_strobe_edges.push(delayedMicros(), digitalReadFast(PIN_CAMERA_STROBE_OUT));
+}
 
-	if (strobe_out == false) {
-		// exposure starts
-		camera_exposure_us = now_us;
-		image_start_latch = true;
+// evaluate the edges of STROBE_OUT collected by cameraStrobeOut()
+void handleCameraStrobeEdges() {
+	edge_event edge;
+	while (camera_strobe_edges.pop(edge)) {
+		if (edge.level == LOW) {
+			// exposure starts
+			camera_exposure_us = edge.at_us;
+			image_start_latch = true;
 #ifdef DEBUG
-		if (debugging_mode)
-			Serial.print('O');
+			if (debugging_mode)
+				serial_out.print('O');
 #endif
-	} else {
-		// exposure ends
+		} else {
+			// exposure ends
 #ifdef DEBUG
-		if (debugging_mode)
-			Serial.print('X');
+			if (debugging_mode)
+				serial_out.print('X');
 #endif
-		image_done_latch = true;
-		// use complementary filter to compute moving average
-		// use nasty bit operations for speed, since we are in an interrupt
-		unsigned long duration_us = now_us - camera_exposure_us;
+			image_done_latch = true;
+			// use complementary filter to compute moving average
+			unsigned long duration_us = edge.at_us - camera_exposure_us;
+			camera_exposure_last_us = duration_us;
 
-		if (camera_exposure_avr_us == 0) {
-			camera_exposure_avr_us = duration_us;
-		}
-		else {
-			// we are in an interrupt and need to be as fast as possible, so use nasty shift operators
-			camera_exposure_avr_deriv_us = (camera_exposure_avr_deriv_us + (camera_exposure_avr_us-duration_us)) >> 1;
-			camera_exposure_avr_us = (camera_exposure_avr_us + duration_us) >> 1;
+			if (camera_exposure_avr_us == 0) {
+				camera_exposure_avr_us = duration_us;
+			}
+			else {
+				camera_exposure_avr_deriv_us = (camera_exposure_avr_deriv_us + (camera_exposure_avr_us-duration_us)) >> 1;
+				camera_exposure_avr_us = (camera_exposure_avr_us + duration_us) >> 1;
+			}
 		}
 	}
 }
 
+void setupScheduler();
+void handleFreqChange();
 
 void setup() {
 
@@ -909,11 +1742,6 @@ void setup() {
 	setDaisyChainOutput(DAISY_INPUT_NOP);
 
 
-#ifdef DO_NIR_TRIGGER
-	// pins used to communicate with the NIR sensor
-	pinModeFast(PIN_NIR_TRIGGER_IN, OUTPUT);
-	digitalWriteFast(PIN_NIR_TRIGGER_IN, LOW);
-#endif
 	// turn off error LED
 	digitalWriteFast(PIN_ERROR_LED, LOW);
 
@@ -926,13 +1754,13 @@ void setup() {
 
 	// camera's trigger_in is using a raising edge
 	digitalWriteFast(PIN_CAMERA_TRIGGER_IN,  LOW);
-	Serial.print(F("Strobing Ctrl/Greyparrot.AI/Jochen Alt V"));
-	Serial.print(VERSION);
+	serial_out.print(F("Strobing Ctrl/Greyparrot.AI/Jochen Alt V"));
+	serial_out.print(VERSION);
 
 #ifdef DEBUG
-	Serial.println("D");
+	serial_out.println("D");
 #else
-	Serial.println("R");
+	serial_out.println("R");
 #endif
 	// read configuration from EEPROM (or initialize if EEPPROM is a virgin)
 	readConfiguration();
@@ -940,7 +1768,7 @@ void setup() {
 	// EPPROM has never been touched, initialized it
 	if (eeprom_master_block.magic_number != EEPROM_MAGIC_NUMBER) {
 		// no one ever touched this EEPROM, initialize it
-		Serial.println(F("Initializing EEPROM"));
+		serial_out.println(F("Initializing EEPROM"));
 		eeprom_master_block.setup();
 		eeprom_master_block.write();
 
@@ -948,23 +1776,26 @@ void setup() {
 		config.write();
 	}
 
-	// start at the beginning of the cycle
-	if(config.external_trigger_mode)
-	{
-		config.full_cycle_len_us = external_trigger_period_us;
-	}
-
 	// compute initial cycle lengths from EPPROM values
-	computeCycleLengths();
-#ifdef DO_NIR_TRIGGER
-	nth_stripe = 0;
+	if(config.external_trigger_mode)
+		computeCycleLengthsExternalTrigger();
+	else
+		computeCycleLengths();
 
+	// pins used to communicate with the NIR camera and further sensors
+	for (uint8_t ch = 0; ch < SUB_TRIGGER_CHANNELS; ch++)
+		applySubTriggerPin(ch);
 
-	computeNirCycleLengths();
-#endif //DO_NIR_TRIGGER
 	// reset the board when wdt_reset() is not called every 120ms
 	wdt_enable(WATCH_DOG_WAIT);
 
+	// Timer1 becomes the time base, so this has to happen before any time is taken
+	timebase.setup();
+#ifdef DO_HW_PULSE_ENGINE
+	pulse_engine.setup();
+#endif
+	setupScheduler();
+
 
 	trigger_return_configuration = false;
 	power_on = false;
@@ -974,206 +1805,838 @@ void setup() {
 	image_start_latch = false;
 	image_done_latch = false;
 	start_cycle_time_us = delayedMicros() + 2*CONTROLLINO_TIME_TO_GO_HIGH;
-	computePulseStartTime();
-	daisyChainFindCameraFreq(config.full_cycle_len_us);
-
-#ifdef DO_NIR_TRIGGER
-	computeNirTriggerStartTime();
-#endif // DO_NIR_TRIGGER
+	compileCycle();
+	timeline.feed();
 
 
 	// for quality reasons this interrupt is listening to the STROBE_OUT signal of the camera
 	// to check if
 	attachInterrupt(digitalPinToInterrupt( PIN_CAMERA_STROBE_OUT), cameraStrobeOut, CHANGE);
 	attachInterrupt(digitalPinToInterrupt( PIN_DAISY_IN0), daisyChainIn, RISING );
+
+	encoder.setup();
+	encoder.setCountsPerImage(config.encoder_counts_per_image);
 }
 
 
-inline void addCmd(char ch) {
-	command += ch;
-	command_pending = true;
+// ranges of the commands, shared by the setters and the staged configuration of S
+inline bool validFullCycleLen(unsigned long full_cycle_len_us) {
+	return (full_cycle_len_us >= 1000000000UL/MAX_IMAGE_FREQUENCY_MHZ) && (full_cycle_len_us <= 1000000000UL/MIN_IMAGE_FREQUENCY_MHZ);
 }
 
-inline void emptyCmd() {
-	command = "";
-	command_pending = false;
+inline bool validDutyLen(unsigned long duty_len_us) {
+	return (duty_len_us >= 50) && (duty_len_us <= 5000);
 }
-bool  execute_serial_command() {
-	// if the last key is too old, reset the command after 1s (command-timeout)
-	if (command_pending && (now_us - cmd_last_char_us) > 1000000) {
-		emptyCmd();
+
+bool validTriggerPlan(unsigned long count, unsigned long spacing_us, unsigned long lead) {
+	return (count >= 1) && (count <= MAX_TRIGGER_STROBE_COUNT) && (lead < count) &&
+		   (spacing_us >= MIN_DUTY_LEN_US*MAX_DUTY_RATIO) && (spacing_us <= MAX_DUTY_LEN_US*MAX_DUTY_RATIO);
+}
+
+// pin 0 turns the channel off, whether the pin is free is checked by isSubTriggerPin()
+bool validSubTrigger(unsigned long pin, unsigned long multiplier, unsigned long divider,
+					 unsigned long pulse_len_us, unsigned long offset_us) {
+	return (pin < TIMELINE_NO_PIN) &&
+		   (multiplier >= 1) && (multiplier <= UINT8_MAX) && (divider >= 1) && (divider <= UINT8_MAX) &&
+		   (pulse_len_us >= MIN_SUB_TRIGGER_LEN_US) && (pulse_len_us <= MAX_SUB_TRIGGER_LEN_US) &&
+		   (offset_us <= 1000000000UL/MIN_IMAGE_FREQUENCY_MHZ);
+}
+
+// setters of the commands shared by the ASCII and the binary protocol, return ReturnOk or the error
+
+// [us] cycle length, applied at the next cycle boundary
+uint8_t setFullCycleLen(unsigned long full_cycle_len_us) {
+	if (!validFullCycleLen(full_cycle_len_us))
+		return ErrorImageFrequencyOutOfRange;
+	// do not set immediately but let this happen in the loop at the beginning at a cycle
+	input_full_cycle_len_us = full_cycle_len_us;
+	freqChange_request = true;
+	return ReturnOk;
+}
+
+// [us] length of the strobing pulse, applied at the next cycle boundary
+uint8_t setDutyLen(unsigned long duty_len_us) {
+	if (!validDutyLen(duty_len_us))
+		return ErrorImageFrequencyOutOfRange;
+	input_light_pulse_duty_len_us = duty_len_us;
+	freqChange_request = true;
+	return ReturnOk;
+}
+
+uint8_t setEncoderCounts(unsigned long counts) {
+	if (counts > MAX_ENCODER_COUNTS_PER_IMAGE)
+		return ErrorImageFrequencyOutOfRange;
+	config.encoder_counts_per_image = counts;
+	encoder.setCountsPerImage(counts);
+	encoder_period_us = 0;
+	return ReturnOk;
+}
+
+// strobe plan of the external trigger
+uint8_t setTriggerPlan(unsigned long count, unsigned long spacing_us, unsigned long lead) {
+	if (!validTriggerPlan(count, spacing_us, lead))
+		return ErrorPulseFrequencyBad;
+	config.trigger_strobe_count = count;
+	config.trigger_strobe_spacing_us = spacing_us;
+	config.trigger_lead_strobes = lead;
+	return ReturnOk;
+}
+
+// sub-trigger channel, pin 0 turns it off
+uint8_t setSubTrigger(unsigned long ch, unsigned long pin, unsigned long multiplier, unsigned long divider,
+					  unsigned long pulse_len_us, unsigned long offset_us) {
+	if ((ch >= SUB_TRIGGER_CHANNELS) || !validSubTrigger(pin, multiplier, divider, pulse_len_us, offset_us) ||
+		!isSubTriggerPin(ch, (pin == 0)?TIMELINE_NO_PIN:pin))
+		return ErrorSubTriggerBad;
+	sub_trigger_config& channel = config.sub_triggers[ch];
+	sub_trigger_config previous = channel;
+	channel.pin = (pin == 0)?TIMELINE_NO_PIN:pin;
+	channel.multiplier = multiplier;
+	channel.divider = divider;
+	channel.pulse_len_us = pulse_len_us;
+	channel.offset_us = offset_us;
+	if (!placeSubTrigger(ch) && config.sub_trigger_interleaved && (channel.pin != TIMELINE_NO_PIN)) {
+		channel = previous;
+		placeSubTrigger(ch);
+		return ErrorSubTriggerOverlap;
 	}
+	applySubTriggerPin(ch);
+	return ReturnOk;
+}
 
-	// check for any input
-	if (Serial.available()) {
-		// store time of last character, for timeout of command
-		cmd_last_char_us = now_us;
+uint8_t setDaisyChainRing(bool ring) {
+	config.daisy_chain_ring = ring;
+	// the status of another ring is not ours
+	daisy_chain_ring_us = 0;
+	return ReturnOk;
+}
 
-		char inputChar = Serial.read();
-		switch (inputChar) {
-			case 'h':
-				if (command == "")
-					printHelp();
-				else
-					addCmd(inputChar);
-				break;
-			case '0':
-				if (command == "") {
-					eeprom_master_block.setup();
-					eeprom_master_block.write();
-					config.setup();
-					config.write();
-					Serial.println(ReturnOk);
-					delay(1000);  // let the watch dog reset
-				}
-				else
-					addCmd(inputChar);
-				break;
+uint8_t setSubTriggerInterleaved(bool interleaved) {
+	if (interleaved && !placeSubTriggers())
+		return ErrorSubTriggerOverlap;
+	config.sub_trigger_interleaved = interleaved;
+	return ReturnOk;
+}
 
-			case 'r':
-				delay(1000);  // let the watch dog reset
+uint8_t setMinTriggerInterval(unsigned long interval_us) {
+	if (interval_us > 1000000000UL/MIN_IMAGE_FREQUENCY_MHZ)
+		return ErrorImageFrequencyOutOfRange;
+	config.min_trigger_interval_us = interval_us;
+	return ReturnOk;
+}
+
+uint8_t setPhaseOffset(unsigned long offset_us) {
+	if (offset_us > maxPhaseOffset())
+		return ErrorPhaseOffsetOutOfRange;
+	unsigned long previous_us = config.phase_offset_us;
+	config.phase_offset_us = offset_us;
+	if (!placeSubTriggers() && config.sub_trigger_interleaved) {
+		config.phase_offset_us = previous_us;
+		placeSubTriggers();
+		return ErrorSubTriggerOverlap;
+	}
+	return ReturnOk;
+}
+
+uint8_t setHopLatency(unsigned long latency_us) {
+	if (latency_us > MAX_DAISY_CHAIN_HOP_LATENCY_US)
+		return ErrorPropagationOutOfRange;
+	config.daisy_chain_hop_latency_us = latency_us;
+	return ReturnOk;
+}
+
+uint8_t setPropagationMode(unsigned long mode) {
+	if (mode > PROPAGATE_POWER_OFF)
+		return ErrorPropagationOutOfRange;
+	propagation_mode = mode;
+	return ReturnOk;
+}
+
+// power on happens at the beginning of a cycle, power off immediately
+void setPower(bool on) {
+	if (on && !power_on)
+		input_power_on = true;
+	else if (!on && power_on)
+		input_power_off = true;
+}
+
+void setErrorLed(bool on) {
+	error_led_mode = on;
+	digitalWriteFast(PIN_ERROR_LED, error_led_mode?HIGH:LOW);
+}
+
+void setFan(bool on) {
+	fan_mode = on;
+	digitalWriteFast(PIN_FAN, fan_mode?HIGH:LOW);
+}
+
+void setTelemetry(bool on) {
+	telemetry_on = on;
+	telemetry_pending = false;
+}
+
+// answer of an ASCII command
+void printResult(uint8_t error) {
+	if (error == ReturnOk)
+		serial_out.println(ReturnOk);
+	else
+		printError(error);
+}
+
+// writes the value of a known field to the reply
+void getBinaryField(uint8_t id) {
+	unsigned long value = 0;
+	switch (id) {
+		case BINARY_FULL_CYCLE_LEN_US:				value = config.full_cycle_len_us; break;
+		case BINARY_LIGHT_PULSE_DUTY_LEN_US:		value = config.light_pulse_duty_len_us; break;
+		case BINARY_LIGHTS_PULSE_LEN_US:			value = config.lights_pulse_len_us; break;
+		case BINARY_NO_OF_STROBES:					value = config.no_of_strobes; break;
+		case BINARY_AUTO_MODE:						value = config.auto_mode_on; break;
+		case BINARY_EXTERNAL_TRIGGER_MODE:			value = config.external_trigger_mode; break;
+		case BINARY_ENCODER_COUNTS_PER_IMAGE:		value = config.encoder_counts_per_image; break;
+		case BINARY_DAISY_CHAIN_HOP_LATENCY_US:		value = config.daisy_chain_hop_latency_us; break;
+		case BINARY_PHASE_OFFSET_US:				value = config.phase_offset_us; break;
+		case BINARY_TRIGGER_PLAN:
+			binary_protocol.writeValue(config.trigger_strobe_count, 2);
+			binary_protocol.writeValue(config.trigger_strobe_spacing_us, 4);
+			binary_protocol.writeValue(config.trigger_lead_strobes, 2);
+			return;
+		case BINARY_MIN_TRIGGER_INTERVAL_US:		value = config.min_trigger_interval_us; break;
+		case BINARY_SUB_TRIGGER0:
+		case BINARY_SUB_TRIGGER1:
+		case BINARY_SUB_TRIGGER2: {
+			const sub_trigger_config& channel = config.sub_triggers[id - BINARY_SUB_TRIGGER0];
+			binary_protocol.write((channel.pin == TIMELINE_NO_PIN)?0:channel.pin);
+			binary_protocol.write(channel.multiplier);
+			binary_protocol.write(channel.divider);
+			binary_protocol.writeValue(channel.pulse_len_us, 4);
+			binary_protocol.writeValue(channel.offset_us, 4);
+			return;
+		}
+		case BINARY_SUB_TRIGGER_INTERLEAVED:		value = config.sub_trigger_interleaved; break;
+		case BINARY_VERSION:						value = VERSION; break;
+		case BINARY_POWER_ON:						value = power_on; break;
+		case BINARY_CAMERA_WORKS:					value = camera_works; break;
+		case BINARY_ERROR_LED:						value = error_led_mode; break;
+		case BINARY_FAN:							value = fan_mode; break;
+		case BINARY_PROPAGATION_MODE:				value = propagation_mode; break;
+		case BINARY_IMAGE_PERIOD_US:				value = measure_image_capture_duration_us; break;
+		case BINARY_PULSE_PERIOD_US:				value = measure_pulse_cycle_duration_us; break;
+		case BINARY_PULSE_DUTY_US:					value = measure_pulse_duty_duration_us; break;
+		case BINARY_CAMERA_EXPOSURE_US:				value = camera_exposure_avr_us; break;
+		case BINARY_DAISY_CHAIN_LOCKED:				value = phase_lock.locked(); break;
+		case BINARY_DAISY_CHAIN_NODE:				value = daisy_chain_node; break;
+		case BINARY_CHAIN_STATUS: {
+			uint16_t status;
+			knownChainNodes(status);
+			value = status;
+			break;
+		}
+		case BINARY_EXTERNAL_TRIGGER_PERIOD_US:		value = external_trigger_period_us; break;
+		case BINARY_TELEMETRY_ON:					value = telemetry_on; break;
+		case BINARY_CHAIN_NODES: {
+			uint16_t status;
+			value = knownChainNodes(status);
+			break;
+		}
+		case BINARY_DAISY_CHAIN_RING:				value = config.daisy_chain_ring; break;
+	}
+	binary_protocol.writeValue(value, binaryFieldSize(id));
+}
+
+// sets a known field to the value in data, returns ReturnOk or the error
+uint8_t setBinaryField(uint8_t id, const uint8_t* data) {
+	unsigned long value = binaryValue(data, binaryFieldSize(id));
+	switch (id) {
+		case BINARY_FULL_CYCLE_LEN_US:				return setFullCycleLen(value);
+		case BINARY_LIGHT_PULSE_DUTY_LEN_US:		return setDutyLen(value);
+		case BINARY_AUTO_MODE:						config.auto_mode_on = (value != 0); return ReturnOk;
+		case BINARY_EXTERNAL_TRIGGER_MODE:			config.external_trigger_mode = (value != 0); return ReturnOk;
+		case BINARY_ENCODER_COUNTS_PER_IMAGE:		return setEncoderCounts(value);
+		case BINARY_DAISY_CHAIN_HOP_LATENCY_US:		return setHopLatency(value);
+		case BINARY_PHASE_OFFSET_US:				return setPhaseOffset(value);
+		case BINARY_TRIGGER_PLAN:					return setTriggerPlan(binaryValue(data, 2), binaryValue(data + 2, 4), binaryValue(data + 6, 2));
+		case BINARY_MIN_TRIGGER_INTERVAL_US:		return setMinTriggerInterval(value);
+		case BINARY_SUB_TRIGGER0:
+		case BINARY_SUB_TRIGGER1:
+		case BINARY_SUB_TRIGGER2:
+			return setSubTrigger(id - BINARY_SUB_TRIGGER0, data[0], data[1], data[2], binaryValue(data + 3, 4), binaryValue(data + 7, 4));
+		case BINARY_SUB_TRIGGER_INTERLEAVED:		return setSubTriggerInterleaved(value != 0);
+		case BINARY_POWER_ON:						setPower(value != 0); return ReturnOk;
+		case BINARY_ERROR_LED:						setErrorLed(value != 0); return ReturnOk;
+		case BINARY_FAN:							setFan(value != 0); return ReturnOk;
+		case BINARY_PROPAGATION_MODE:				return setPropagationMode(value);
+		case BINARY_TELEMETRY_ON:					setTelemetry(value != 0); return ReturnOk;
+		case BINARY_DAISY_CHAIN_RING:				return setDaisyChainRing(value != 0);
+		default:
+			// read only
+			return ErrorBinaryFieldBad;
+	}
+}
+
+/***********************************/
+/* Staged configuration (S)        */
+/***********************************/
+
+// S and BINARY_SET_STAGED change several values of the configuration at once, like frame rate and duty of
+// a recipe. The values are staged in staged_config and checked together, then commitStagedConfiguration()
+// applies them at the next cycle boundary with one recompute of the cycle and one EEPROM write.
+// Values that are not staged keep changing with their own commands in the meantime.
+configuration_type staged_config;				// configuration with the staged values
+uint16_t staged_fields = 0;						// bit(id) of the BinaryField ids staged in staged_config
+
+// stages one configuration field into c after checking its range. values are the numbers of the field
+// in the order of its command, the sub-trigger without the channel
+uint8_t stageField(configuration_type& c, uint8_t id, const unsigned long values[]) {
+	unsigned long value = values[0];
+	switch (id) {
+		case BINARY_FULL_CYCLE_LEN_US:
+			if (!validFullCycleLen(value))
+				return ErrorImageFrequencyOutOfRange;
+			c.full_cycle_len_us = value;
+			return ReturnOk;
+		case BINARY_LIGHT_PULSE_DUTY_LEN_US:
+			if (!validDutyLen(value))
+				return ErrorImageFrequencyOutOfRange;
+			c.light_pulse_duty_len_us = constrain(value, MIN_DUTY_LEN_US, MAX_DUTY_LEN_US);
+			c.lights_pulse_len_us = MAX_DUTY_RATIO * c.light_pulse_duty_len_us;
+			return ReturnOk;
+		case BINARY_AUTO_MODE:						c.auto_mode_on = (value != 0); return ReturnOk;
+		case BINARY_EXTERNAL_TRIGGER_MODE:			c.external_trigger_mode = (value != 0); return ReturnOk;
+		case BINARY_ENCODER_COUNTS_PER_IMAGE:
+			if (value > MAX_ENCODER_COUNTS_PER_IMAGE)
+				return ErrorImageFrequencyOutOfRange;
+			c.encoder_counts_per_image = value;
+			return ReturnOk;
+		case BINARY_DAISY_CHAIN_HOP_LATENCY_US:
+			if (value > MAX_DAISY_CHAIN_HOP_LATENCY_US)
+				return ErrorPropagationOutOfRange;
+			c.daisy_chain_hop_latency_us = value;
+			return ReturnOk;
+		case BINARY_PHASE_OFFSET_US:
+			// checked against the staged cycle by checkStagedConfiguration()
+			if (value > 1000000000UL/MIN_IMAGE_FREQUENCY_MHZ)
+				return ErrorPhaseOffsetOutOfRange;
+			c.phase_offset_us = value;
+			return ReturnOk;
+		case BINARY_TRIGGER_PLAN:
+			if (!validTriggerPlan(values[0], values[1], values[2]))
+				return ErrorPulseFrequencyBad;
+			c.trigger_strobe_count = values[0];
+			c.trigger_strobe_spacing_us = values[1];
+			c.trigger_lead_strobes = values[2];
+			return ReturnOk;
+		case BINARY_MIN_TRIGGER_INTERVAL_US:
+			if (value > 1000000000UL/MIN_IMAGE_FREQUENCY_MHZ)
+				return ErrorImageFrequencyOutOfRange;
+			c.min_trigger_interval_us = value;
+			return ReturnOk;
+		case BINARY_SUB_TRIGGER0:
+		case BINARY_SUB_TRIGGER1:
+		case BINARY_SUB_TRIGGER2: {
+			if (!validSubTrigger(values[0], values[1], values[2], values[3], values[4]))
+				return ErrorSubTriggerBad;
+			sub_trigger_config& channel = c.sub_triggers[id - BINARY_SUB_TRIGGER0];
+			channel.pin = (values[0] == 0)?TIMELINE_NO_PIN:values[0];
+			channel.multiplier = values[1];
+			channel.divider = values[2];
+			channel.pulse_len_us = values[3];
+			channel.offset_us = values[4];
+			return ReturnOk;
+		}
+		case BINARY_SUB_TRIGGER_INTERLEAVED:		c.sub_trigger_interleaved = (value != 0); return ReturnOk;
+		default:
+			// read only or no configuration
+			return ErrorBinaryFieldBad;
+	}
+}
+
+// checks the staged fields of c together, with the cycle they end up with. The cycle lengths of c are derived
+// like computeCycleLengths() does, unless the external trigger sets them
+uint8_t checkStagedConfiguration(configuration_type& c, uint16_t fields) {
+	bool cycle_staged = (fields & (bit(BINARY_FULL_CYCLE_LEN_US) | bit(BINARY_LIGHT_PULSE_DUTY_LEN_US))) != 0;
+	if (cycle_staged && !c.external_trigger_mode)
+		computeStrobes(c);
+	if ((fields & bit(BINARY_PHASE_OFFSET_US)) && (c.phase_offset_us > maxPhaseOffset(c)))
+		return ErrorPhaseOffsetOutOfRange;
+
+	bool sub_triggers_staged = cycle_staged || (fields & bit(BINARY_SUB_TRIGGER_INTERLEAVED));
+	for (uint8_t ch = 0; ch < SUB_TRIGGER_CHANNELS; ch++) {
+		if (fields & bit(BINARY_SUB_TRIGGER0 + ch)) {
+			if (!isSubTriggerPin(ch, c.sub_triggers[ch].pin, c))
+				return ErrorSubTriggerBad;
+			sub_triggers_staged = true;
+		}
+	}
+	if (c.sub_trigger_interleaved && sub_triggers_staged)
+		for (uint8_t ch = 0; ch < SUB_TRIGGER_CHANNELS; ch++)
+			if ((c.sub_triggers[ch].pin != TIMELINE_NO_PIN) && !subTriggerFitsInDark(c, ch))
+				return ErrorSubTriggerOverlap;
+	return ReturnOk;
+}
+
+// stages the fields of c if they pass the check, otherwise nothing is staged
+uint8_t stageConfiguration(configuration_type& c, uint16_t fields) {
+	uint8_t error = checkStagedConfiguration(c, fields);
+	if (error == ReturnOk) {
+		staged_config = c;
+		staged_fields = fields;
+	}
+	return error;
+}
+
+// stages the commands of S separated by ';', like Sf7.5;l1200;o500 or Sx5,10000,2;t.
+// A command that is rejected drops the whole line, as does a line without commands
+uint8_t stageCommands() {
+	configuration_type c = (staged_fields != 0)?staged_config:config;
+	uint16_t fields = staged_fields;
+	char* part = command.nextPart(';');
+	if (part == nullptr)
+		return ErrorUnknownCommand;
+	for (; part != nullptr; part = command.nextPart(';')) {
+		unsigned long values[6];
+		const unsigned long* field_values = values;
+		uint8_t id = 0;
+		uint8_t error = ReturnOk;
+		bool flag = (part[0] != 0) && (part[1] == 0);	// a/A, t/T, i/I have no parameters
+		switch (part[0]) {
+			case 'f': {
+				unsigned long freq_mhz = parseMilli(part + 1);
+				id = BINARY_FULL_CYCLE_LEN_US;
+				values[0] = (freq_mhz != 0)?(1000000000UL + freq_mhz/2)/freq_mhz:0;
 				break;
-			case 'e':
-				delayedWriteConfiguration();
-				Serial.println(ReturnOk);
+			}
+			case 'l': id = BINARY_LIGHT_PULSE_DUTY_LEN_US; values[0] = parseNumber(part + 1); break;
+			case 'c': id = BINARY_ENCODER_COUNTS_PER_IMAGE; values[0] = parseNumber(part + 1); break;
+			case 'g': id = BINARY_MIN_TRIGGER_INTERVAL_US; values[0] = parseNumber(part + 1); break;
+			case 'o': id = BINARY_PHASE_OFFSET_US; values[0] = parseNumber(part + 1); break;
+			case 'k': id = BINARY_DAISY_CHAIN_HOP_LATENCY_US; values[0] = parseNumber(part + 1); break;
+			case 'x':
+				id = BINARY_TRIGGER_PLAN;
+				if (!parseList(part + 1, values, 3))
+					error = ErrorPulseFrequencyBad;
 				break;
-			case 's':
-				if (command == "")
-					if (power_on)
-						trigger_return_configuration = true;
-					else
-						returnConfiguration();
-				else
-					addCmd(inputChar);
+			case 'u':
+				if (parseList(part + 1, values, 6) && (values[0] < SUB_TRIGGER_CHANNELS)) {
+					id = BINARY_SUB_TRIGGER0 + values[0];
+					field_values = values + 1;
+				} else
+					error = ErrorSubTriggerBad;
 				break;
-			case 'd':
-#ifdef DEBUG
-			case 'D':
-				if (command == "") {
-					debugging_mode = (inputChar=='d');
-					Serial.println(ReturnOk);
-				}
-				else
-					addCmd(inputChar);
+			case 'a':
+			case 'A': id = BINARY_AUTO_MODE; values[0] = (part[0] == 'a'); break;
+			case 't':
+			case 'T': id = BINARY_EXTERNAL_TRIGGER_MODE; values[0] = (part[0] == 't'); break;
+			case 'i':
+			case 'I': id = BINARY_SUB_TRIGGER_INTERLEAVED; values[0] = (part[0] == 'i'); break;
+			default:
+				error = ErrorUnknownCommand;
+		}
+		if ((error == ReturnOk) && !flag && ((id == BINARY_AUTO_MODE) || (id == BINARY_EXTERNAL_TRIGGER_MODE) ||
+											 (id == BINARY_SUB_TRIGGER_INTERLEAVED)))
+			error = ErrorUnknownCommand;
+		if (error == ReturnOk)
+			error = stageField(c, id, field_values);
+		if (error != ReturnOk)
+			return error;
+		fields |= bit(id);
+	}
+	return stageConfiguration(c, fields);
+}
+
+// stages the fields of a BINARY_SET_STAGED frame starting at pos. pos ends at the rejected field
+uint8_t stageBinaryFields(const uint8_t* frame, uint8_t len, uint8_t& pos) {
+	configuration_type c = (staged_fields != 0)?staged_config:config;
+	uint16_t fields = staged_fields;
+	for (; pos < len; pos += 1 + binaryFieldSize(frame[pos])) {
+		uint8_t id = frame[pos];
+		const uint8_t* data = frame + pos + 1;
+		uint8_t size = binaryFieldSize(id);
+		if ((size == 0) || (pos + 1 + size > len))
+			return ErrorBinaryFieldBad;
+		unsigned long values[5];
+		if (id == BINARY_TRIGGER_PLAN) {
+			values[0] = binaryValue(data, 2);
+			values[1] = binaryValue(data + 2, 4);
+			values[2] = binaryValue(data + 6, 2);
+		} else if ((id >= BINARY_SUB_TRIGGER0) && (id <= BINARY_SUB_TRIGGER2)) {
+			values[0] = data[0];
+			values[1] = data[1];
+			values[2] = data[2];
+			values[3] = binaryValue(data + 3, 4);
+			values[4] = binaryValue(data + 7, 4);
+		} else
+			values[0] = binaryValue(data, size);
+		uint8_t error = stageField(c, id, values);
+		if (error != ReturnOk)
+			return error;
+		fields |= bit(id);
+	}
+	return stageConfiguration(c, fields);
+}
+
+// applies the staged fields at the cycle boundary, called right after handleFreqChange(),
+// so the staged values win over f and l keyed in before
+void commitStagedConfiguration() {
+	uint16_t fields = staged_fields;
+	staged_fields = 0;
+
+	// the interrupts see all values of the transaction or none of them
+	uint8_t sreg = SREG;
+	cli();
+	for (uint8_t id = BINARY_FULL_CYCLE_LEN_US; id <= BINARY_SUB_TRIGGER_INTERLEAVED; id++) {
+		if (!(fields & bit(id)))
+			continue;
+		switch (id) {
+			case BINARY_FULL_CYCLE_LEN_US:			config.full_cycle_len_us = staged_config.full_cycle_len_us; break;
+			case BINARY_LIGHT_PULSE_DUTY_LEN_US:
+				config.light_pulse_duty_len_us = staged_config.light_pulse_duty_len_us;
+				config.lights_pulse_len_us = MAX_DUTY_RATIO * config.light_pulse_duty_len_us;
 				break;
-#endif
-			case 'n':
-			case 'N':
-				if (command == "") {
-					error_led_mode= (inputChar=='n');
-					digitalWriteFast(PIN_ERROR_LED, error_led_mode?HIGH:LOW);
-					Serial.println(ReturnOk);
-				}
-				else
-					addCmd(inputChar);
+			case BINARY_AUTO_MODE:					config.auto_mode_on = staged_config.auto_mode_on; break;
+			case BINARY_EXTERNAL_TRIGGER_MODE:		config.external_trigger_mode = staged_config.external_trigger_mode; break;
+			case BINARY_ENCODER_COUNTS_PER_IMAGE:	config.encoder_counts_per_image = staged_config.encoder_counts_per_image; break;
+			case BINARY_DAISY_CHAIN_HOP_LATENCY_US:	config.daisy_chain_hop_latency_us = staged_config.daisy_chain_hop_latency_us; break;
+			case BINARY_PHASE_OFFSET_US:			config.phase_offset_us = staged_config.phase_offset_us; break;
+			case BINARY_TRIGGER_PLAN:
+				config.trigger_strobe_count = staged_config.trigger_strobe_count;
+				config.trigger_strobe_spacing_us = staged_config.trigger_strobe_spacing_us;
+				config.trigger_lead_strobes = staged_config.trigger_lead_strobes;
 				break;
+			case BINARY_MIN_TRIGGER_INTERVAL_US:	config.min_trigger_interval_us = staged_config.min_trigger_interval_us; break;
+			case BINARY_SUB_TRIGGER0:
+			case BINARY_SUB_TRIGGER1:
+			case BINARY_SUB_TRIGGER2:
+				config.sub_triggers[id - BINARY_SUB_TRIGGER0] = staged_config.sub_triggers[id - BINARY_SUB_TRIGGER0];
+				break;
+			case BINARY_SUB_TRIGGER_INTERLEAVED:	config.sub_trigger_interleaved = staged_config.sub_trigger_interleaved; break;
+		}
+	}
+	SREG = sreg;
+
+	// one recompute of the cycle for all of them, the external trigger has its own plan
+	if (config.external_trigger_mode) {
+		if (fields & (bit(BINARY_TRIGGER_PLAN) | bit(BINARY_EXTERNAL_TRIGGER_MODE)))
+			computeCycleLengthsExternalTrigger();
+	} else if (fields & (bit(BINARY_FULL_CYCLE_LEN_US) | bit(BINARY_LIGHT_PULSE_DUTY_LEN_US) | bit(BINARY_EXTERNAL_TRIGGER_MODE))) {
+		computeCycleLengths();
+	}
+	if (fields & bit(BINARY_ENCODER_COUNTS_PER_IMAGE)) {
+		encoder.setCountsPerImage(config.encoder_counts_per_image);
+		encoder_period_us = 0;
+	}
+	for (uint8_t ch = 0; ch < SUB_TRIGGER_CHANNELS; ch++)
+		if (fields & bit(BINARY_SUB_TRIGGER0 + ch))
+			applySubTriggerPin(ch);
+	placeSubTriggers();
+	delayedWriteConfiguration();
+}
 
-			case 'v':
-			case 'V':
-				if (command == "") {
-					fan_mode= (inputChar=='v');
-					digitalWriteFast(PIN_FAN, fan_mode?HIGH:LOW);
-					Serial.println(ReturnOk);
-				}
-				else
-					addCmd(inputChar);
+// answers the frame received by binary_protocol, see binaryProtocol.h
+void handleBinaryFrame() {
+	const uint8_t* frame = binary_protocol.frame();
+	uint8_t len = binary_protocol.frameLength();
+	uint8_t type = frame[0];
+	uint8_t error = ReturnOk;
+	uint8_t pos = 1;
+
+	if (type == BINARY_GET) {
+		// the error goes first, so all ids are checked before values are returned
+		uint8_t end = 1;
+		while ((end < len) && (binaryFieldSize(frame[end]) != 0))
+			end++;
+		if (end < len)
+			error = ErrorBinaryFieldBad;
+
+		binary_protocol.beginReply(type | BINARY_REPLY);
+		binary_protocol.write(error);
+		for (; pos < end; pos++) {
+			binary_protocol.write(frame[pos]);
+			getBinaryField(frame[pos]);
+		}
+	} else if (type == BINARY_SET) {
+		// fields are set one after the other until one is rejected
+		while (pos < len) {
+			uint8_t size = binaryFieldSize(frame[pos]);
+			if ((size == 0) || (pos + 1 + size > len))
+				error = ErrorBinaryFieldBad;
+			else
+				error = setBinaryField(frame[pos], frame + pos + 1);
+			if (error != ReturnOk)
 				break;
+			pos += 1 + size;
+		}
 
-			case 'a':
-			case 'A':
-				if (command == "") {
-					config.auto_mode_on = (inputChar=='a');
-					Serial.println(ReturnOk);
-				}
+		binary_protocol.beginReply(type | BINARY_REPLY);
+		binary_protocol.write(error);
+	} else if (type == BINARY_SET_STAGED) {
+		// nothing is staged if one field is rejected
+		error = stageBinaryFields(frame, len, pos);
+		binary_protocol.beginReply(type | BINARY_REPLY);
+		binary_protocol.write(error);
+	} else {
+		binary_protocol.beginReply(BINARY_UNKNOWN_TYPE);
+		binary_protocol.write(ErrorUnknownCommand);
+		binary_protocol.write(type);
+		binary_protocol.endReply();
+		return;
+	}
+	if (pos < len)
+		binary_protocol.write(frame[pos]);
+	binary_protocol.endReply();
+}
+
+inline void addCmd(char ch) {
+	command.add(ch);
+	command_pending = true;
+}
+
+inline void emptyCmd() {
+	command.clear();
+	command_pending = false;
+}
+
+// handles one character of the serial input
+void execute_serial_char(char inputChar) {
+	// a frame of the binary protocol starts with END, which is no ASCII character
+	if (binary_protocol.receiving() || ((uint8_t)inputChar == BINARY_FRAME_END)) {
+		if (binary_protocol.receive(inputChar))
+			handleBinaryFrame();
+		return;
+	}
+
+	switch (inputChar) {
+		case 'h':
+			if (command.empty())
+				printHelp();
+			else
+				addCmd(inputChar);
+			break;
+		case '0':
+			if (command.empty()) {
+				eeprom_master_block.setup();
+				eeprom_master_block.write();
+				config.setup();
+				config.write();
+				serial_out.println(ReturnOk);
+				serial_out.flush();
+				delay(1000);  // let the watch dog reset
+			}
+			else
+				addCmd(inputChar);
+			break;
+
+		case 'r':
+			serial_out.flush();
+			delay(1000);  // let the watch dog reset
+			break;
+		case 'e':
+			delayedWriteConfiguration();
+			serial_out.println(ReturnOk);
+			break;
+		case 's':
+			if (command.empty())
+				if (power_on)
+					trigger_return_configuration = true;
 				else
-					addCmd(inputChar);
-				break;
+					returnConfiguration();
+			else
+				addCmd(inputChar);
+			break;
+		case 'q':
+			if (command.empty())
+				if (power_on)
+					trigger_return_chain_status = true;
+				else
+					returnChainStatus();
+			else
+				addCmd(inputChar);
+			break;
+		case 'd':
+#ifdef DEBUG
+		case 'D':
+			if (command.empty()) {
+				debugging_mode = (inputChar=='d');
+				serial_out.println(ReturnOk);
+			}
+			else
+				addCmd(inputChar);
+			break;
+#endif
+		case 'n':
+		case 'N':
+			if (command.empty()) {
+				setErrorLed(inputChar=='n');
+				serial_out.println(ReturnOk);
+			}
+			else
+				addCmd(inputChar);
+			break;
 
-			case 'p':
-			case 'P':
-				if (command == "") {
-					if (inputChar=='p' && !power_on)
-						input_power_on = true;
-					else {
-						if ((inputChar =='P') && power_on)
-							input_power_off = true;
-					}
-					Serial.println(ReturnOk);
+		case 'v':
+		case 'V':
+			if (command.empty()) {
+				setFan(inputChar=='v');
+				serial_out.println(ReturnOk);
+			}
+			else
+				addCmd(inputChar);
+			break;
+
+		case 'a':
+		case 'A':
+			if (command.empty()) {
+				config.auto_mode_on = (inputChar=='a');
+				serial_out.println(ReturnOk);
+			}
+			else
+				addCmd(inputChar);
+			break;
+
+		case 'p':
+		case 'P':
+			if (command.empty()) {
+				setPower(inputChar=='p');
+				serial_out.println(ReturnOk);
+			}
+			else
+				addCmd(inputChar);
+			break;
+		case 'i':
+		case 'I':
+			if (command.empty())
+				printResult(setSubTriggerInterleaved(inputChar == 'i'));
+			else
+				addCmd(inputChar);
+			break;
+		case 'w':
+		case 'W':
+			if (command.empty())
+				printResult(setDaisyChainRing(inputChar == 'w'));
+			else
+				addCmd(inputChar);
+			break;
+		case 'm':
+		case 'M':
+			if (command.empty()) {
+				setTelemetry(inputChar == 'm');
+				serial_out.println(ReturnOk);
+			}
+			else
+				addCmd(inputChar);
+			break;
+		case 'T':
+		case 't':
+			if (command.empty()) {
+				if (inputChar=='t')
+				{
+					config.external_trigger_mode = true;
 				}
-				else
-					addCmd(inputChar);
-				break;
-			case 'T':
-			case 't':
-				if (command == "") {
-					if (inputChar=='t')
-					{
-						config.external_trigger_mode = true;
-					}
-					else if (inputChar=='T')
-					{
-						config.external_trigger_mode = false;
-					}
-					Serial.println(ReturnOk);
+				else if (inputChar=='T')
+				{
+					config.external_trigger_mode = false;
 				}
-				else
-					addCmd(inputChar);
+				serial_out.println(ReturnOk);
+			}
+			else
+				addCmd(inputChar);
+			break;
+		case 13:
+		case 10:
+			if (command.overflow()) {
+				printError(ErrorUnknownCommand);
+				emptyCmd();
 				break;
-			case 13:
-			case 10:
-				// command to set time between two images in [us]
-				// anything between 3 and 20 fps is allowed
-				if (command.startsWith("f")) {
-					unsigned long l = command.substring(1).toInt();
-					// currently the lowest frequency is 1Hz. lower than 1Hz, and the measure would get an overflow
-					// since then input_full_cycle_len_us is 1000000, and the measures are filtering by multiplying with 4096
-					// if that needs to be fixed, measurements need to become more coarse grained
-					if (((l >= 1) && (l <= 30))) {
-						// do not set immediately but let this happen in the loop at the beginning at a cycle
-						input_full_cycle_len_us  = ((1000000UL/l)>>2)<<2; // timer has a resolution of 8us, so make it dividable by
-						freqChange_request = true;
-						Serial.println(ReturnOk);
-					}
-					else {
-						printError(ErrorImageFrequencyOutOfRange);
-					}
-					emptyCmd();
-				} else if (command.startsWith("l")) {
-					unsigned long l = command.substring(1).toInt();
-					if ((l>=50) && (l<=5000)) {
-						input_light_pulse_duty_len_us  = (l>>2)<<2; // timer has a resolution of 8us, so make it dividable by 4
-						freqChange_request = true;
-						Serial.println(ReturnOk);
-					}
-					else {
+			}
+			switch (command.letter()) {
+				case 0:
+					break;
+				case 'f': {
+					// command to set the frequency of the camera in Hz with up to three decimals, like f7.5
+					// anything between 0.5 and 60 fps is allowed
+					unsigned long freq_mhz = parseMilli(command.parameters());
+					if ((freq_mhz >= MIN_IMAGE_FREQUENCY_MHZ) && (freq_mhz <= MAX_IMAGE_FREQUENCY_MHZ))
+						printResult(setFullCycleLen((1000000000UL + freq_mhz/2)/freq_mhz));
+					else
 						printError(ErrorImageFrequencyOutOfRange);
-					}
-					emptyCmd();
-				} else if (command.startsWith("b")) {
-					unsigned long l = command.substring(1).toInt();
-					if ((l >= 0) && (l <= PROPAGATE_POWER_OFF)) {
-						propagation_mode = l;
-					    Serial.println(ReturnOk);
-					}
-					else {
-						printError(ErrorPropagationOutOfRange);
-					}
-					emptyCmd();
+					break;
 				}
-
-				if (command != "") {
-					printError(ErrorUnknownCommand);
+				case 'l':
+					printResult(setDutyLen(parseNumber(command.parameters())));
+					break;
+				case 'c':
+					printResult(setEncoderCounts(parseNumber(command.parameters())));
+					break;
+				case 'x': {
+					// strobe plan of the external trigger, like x5,10000,2
+					unsigned long plan[3];
+					if (parseList(command.parameters(), plan, 3))
+						printResult(setTriggerPlan(plan[0], plan[1], plan[2]));
+					else
+						printError(ErrorPulseFrequencyBad);
+					break;
 				}
-				emptyCmd();
-				break;
-
+				case 'u': {
+					// sub-trigger channel, like u1,4,1,2,500,0 for a pulse of 500us every other image on pin 4
+					unsigned long sub[6];
+					if (parseList(command.parameters(), sub, 6))
+						printResult(setSubTrigger(sub[0], sub[1], sub[2], sub[3], sub[4], sub[5]));
+					else
+						printError(ErrorSubTriggerBad);
+					break;
+				}
+				case 'g':
+					printResult(setMinTriggerInterval(parseNumber(command.parameters())));
+					break;
+				case 'o':
+					printResult(setPhaseOffset(parseNumber(command.parameters())));
+					break;
+				case 'k':
+					if (command.length() == 1) {
+						// answers once the measurement is done
+						startDaisyChainCalibration();
+					} else {
+						printResult(setHopLatency(parseNumber(command.parameters())));
+					}
+					break;
+				case 'b':
+					printResult(setPropagationMode(parseNumber(command.parameters())));
+					break;
+				case 'S':
+					// several values at once, applied together at the next cycle boundary
+					printResult(stageCommands());
+					break;
 				default:
-				addCmd(inputChar);
-			} // switch
+					printError(ErrorUnknownCommand);
+			}
+			emptyCmd();
+			break;
 
-			return true;
+			default:
+			addCmd(inputChar);
+	} // switch
+}
 
-		} // if (Serial.available())
+bool  execute_serial_command() {
+	// if the last key is too old, reset the command after 1s (command-timeout)
+	if ((command_pending || binary_protocol.receiving()) && (now_us - cmd_last_char_us) > 1000000) {
+		emptyCmd();
+		binary_protocol.reset();
+	}
+
+	// check for any input
+	if (Serial.available()) {
+		// store time of last character, for timeout of command
+		cmd_last_char_us = now_us;
+
+		// read all characters that came in, until a command has been executed or the time is up
+		unsigned long start_us = delayedMicros();
+		do {
+			execute_serial_char(Serial.read());
+		} while ((command_pending || binary_protocol.receiving()) && Serial.available() &&
+				 ((delayedMicros() - start_us) < SERIAL_COMMAND_READ_US));
+		return true;
+	}
 	else
 		return false;
 }
@@ -1184,132 +2647,155 @@ void loop() {
 	// run main loop with a state machine controlling the camera and the lights
 	now_us = delayedMicros();
 
+	// the daisy chain or the external trigger started a new cycle
+	if (cycle_restart_requested) {
+		cycle_restart_requested = false;
+		// a restart is a cycle boundary as well
+		if (freqChange_request)
+			handleFreqChange();
+		if (staged_fields != 0)
+			commitStagedConfiguration();
+		if (config.external_trigger_mode)
+			handleIN0TriggerEvent();
+		restartCycle();
+	}
+
+	// the encoder reached the position of the next image. Wait for the lights to go off
+	// to not cut a pulse, that is as short as the duty
+	unsigned long encoder_interval_us;
+	if ((config.encoder_counts_per_image != 0) && !config.external_trigger_mode && !pulse_state &&
+		encoder.pollTrigger(encoder_interval_us)) {
+		handleEncoderTrigger(encoder_interval_us);
+	}
+
 	// *** take care of the lights ***
-	// This is most important to happen right after measuring the time to get the most precision
+	// all edges are precompiled in the timeline, outputting them is most important
+	// to happen right after measuring the time to get the most precision
+	timeline.enable(power_on);
+	// the interrupt might have requested a restart meanwhile, then nothing of the old schedule goes out
+	if (!cycle_restart_requested) {
+#ifdef DO_HW_PULSE_ENGINE
+		// events are output by the compare interrupt, this only restarts it if the timeline ran dry
+		pulse_engine.service();
+#else
+		if (timeline.due(timebase.ticks()))
+			timeline.fire();
+#endif
+	}
+
+	// bookkeeping of events that have been output
 	bool pulse_turned_on = false;	// true if the lights just turned on
-	bool pulse_turned_off = false;	// true, if the lights just turned off
-
-	if (pulse_state == false) {
-		///@note Some modulo math to deal with overflow this is the same as
-		//		((now - next) % ULONG_MAX) < ULONG_MAX/2
-		unsigned long modulo_diff = now_us - next_pulse_start_time;
- 		if (modulo_diff < ULONG_MAX/2) {
-			if (power_on) {
-				digitalWriteFast(PIN_LIGHTING_PNP, HIGH); //turn lights on
-				if (nth_strobe == 0) {
-					if (!image_capture_turned_on) {
-						// this delay represents the time the lights need to be turned on
-						delayMicroseconds(LIGHTS_PULSE_ON_DELAY);
-
-						image_capture_turned_on = true;
-						// indicate that the camera gets the trigger to take an image
-						digitalWriteFast(PIN_CAMERA_TRIGGER_IN,  HIGH);
+	unsigned long fired_ticks;
+	uint8_t markers = timeline.handleNext(fired_ticks);
+	// [us] time the event went out, loop() sees it later
+	unsigned long fired_us = (markers != MARKER_NONE)?timebase.microsAt(fired_ticks):now_us;
+	if ((markers & MARKER_CAMERA_ON) && power_on)
+		image_trigger_us = fired_us;
+	if (markers & MARKER_PULSE_ON) {
+		if (power_on) {
+			if ((nth_strobe == 0) && camera_cycle && !image_capture_turned_on) {
+				image_capture_turned_on = true;
 
 #ifdef DEBUG
-						if (debugging_mode)
-							Serial.print('o');
+				if (debugging_mode)
+					serial_out.print('o');
 #endif
-						measureImageCapture(); // quality assurance, measure average frequency
-
-					}
-				} else {
-					if (nth_strobe == 1) {
-						// reset Daisy Chain command to be prepared for setting it up next time
-						setDaisyChainOutput(DAISY_INPUT_NOP);
-					}
-				}
+				measureImageCapture(); // quality assurance, measure average frequency
 			}
+		}
 
-#ifdef DEBUG
-			if (nth_strobe > 0) // following call takes 40us, dont do that in the pulse when the camera is turned on to have some buffer there
-				measurePulseStart(); // quality assurance, measure average frequency
+		// the times come from the timeline, so it does not matter when loop() gets here.
+		// The break before the first pulse of a cycle is no pulse period
+		if (nth_strobe == 0)
+			measure_pulse_start_us = 0;
+		measurePulseStart(fired_us); // quality assurance, measure average frequency
 
-			if (debugging_mode)
-				if (nth_strobe == 0)
-					Serial.print('[');
-				else
-					Serial.print('<');
+#ifdef DEBUG
+		if (debugging_mode)
+			if (nth_strobe == 0)
+				serial_out.print('[');
+			else
+				serial_out.print('<');
 #endif
-			pulse_turned_on = true;
-			pulse_state = true;
-		} else {
-			execute_serial_command();
-		}
-	} else {
-		unsigned long modulo_diff = now_us - next_pulse_end_time;
- 		if (modulo_diff < ULONG_MAX/2 ) {
-			if (power_on) {
-				digitalWriteFast(PIN_LIGHTING_PNP, LOW);// turn lights off
-
-				// tell your slave to start the cycle when we are at the end
-				if (nth_strobe == 0) {
-					setDaisyChainOutput(DAISY_INPUT_CYCLE_START);
-				}
-
-			}
+		pulse_turned_on = true;
+		pulse_state = true;
+	} else if (markers & MARKER_PULSE_OFF) {
+		measurePulseEnd(fired_us); // quality assurance, measure average frequency
 #ifdef DEBUG
-			if (nth_strobe > 0)
-				measurePulseEnd(); // quality assurance, measure average frequency
-			if (debugging_mode)
-				Serial.print('>');
+		if (debugging_mode)
+			serial_out.print('>');
 #endif
-			if (nth_strobe < config.no_of_strobes-1) {
-				nth_strobe++;
+		last_pulse_off_us = now_us;
+		// CYCLE_START went out with the end of the first pulse, the frame follows
+		if ((nth_strobe == 0) && camera_cycle) {
+			daisy_frame_next_byte = 0;
+			daisy_frame_cycle_start_ticks = daisy_chain_cycle_start_ticks;
+		}
+		if (nth_strobe < cycleStrobes()-1) {
+			nth_strobe++;
+		}
+		else {
+			if(config.external_trigger_mode)
+			{
+				power_on = false;
 			}
-			else {
-				if(config.external_trigger_mode)
-				{
-					power_on = false;
-				}
-				start_cycle_time_us += config.full_cycle_len_us;
-				nth_strobe = 0;
-				nth_stripe = 0;
-				nir_trigger_state = false;
-				computeNirTriggerStartTime();
-				// have we received a signal from master in the last cycle?
-				if (daisy_chain_slave) {
-					// reset the slave flag (to be set again when we get a new master cycle)
-					daisy_chain_slave = false;
-
+			start_cycle_time_us += cycleLen();
+			nth_strobe = 0;
+			// have we received a signal from master in the last cycle?
+			if (daisy_chain_slave) {
+				// reset the slave flag (to be set again when we get a new master cycle)
+				daisy_chain_slave = false;
+				// the leader is back, the phase lock takes over where the holdover left
+				daisy_chain_holdover = false;
+
+				if (phase_lock.tracking()) {
+					// the cycle runs with the leader's period, the phase lock moves its start towards the leader's
+					start_cycle_time_us += (long)(phase_lock.period() - cycleLen()) + phase_lock.takeCorrection();
+				} else {
 					// we give ourselves half a pulse to wait for the master's voice and tell
 					// us when to start the next cycle. Afterwards, we
 					// continue autonomously
 					start_cycle_time_us += config.lights_pulse_len_us >> 1;
 				}
+			} else if (phase_lock.locked() && !config.external_trigger_mode) {
+				// the leader got lost, keep its period and phase until it is back
+				if (!daisy_chain_holdover) {
+					daisy_chain_holdover = true;
+					daisy_chain_holdover_start_us = start_cycle_time_us;
+					phase_lock.holdover();
+					printError(ErrorDaisyChainLeaderLost);
+				}
+				if (start_cycle_time_us - daisy_chain_holdover_start_us < DAISY_CHAIN_HOLDOVER_MAX_US) {
+					start_cycle_time_us += (long)(phase_lock.period() - cycleLen());
+				} else {
+					// give up and run on our own, the phase slews back in once the leader is back
+					daisy_chain_holdover = false;
+					phase_lock.unlock();
+				}
+			} else {
+				// head of the chain, or the leader got lost for good
+				daisy_chain_holdover = false;
+				daisy_chain_node = 0;
+				daisy_chain_upstream_status = 0;
 			}
-			pulse_turned_off = true;
-			pulse_state = false;
-			computePulseStartTime();
-		}
-	}
-
-#ifdef DO_NIR_TRIGGER
-	if (nir_trigger_state == false) {
-		// the way this statement is phrased deals with an overflow of now_us
-		if (now_us - next_nir_trigger_start_time < config.full_cycle_len_us) {
-			if (power_on) {
-					// indicate that the NIR gets the trigger to take an image
-					digitalWriteFast(PIN_NIR_TRIGGER_IN,  HIGH);
-			}
-			nir_trigger_state = true;
+			// new frequency and duty take effect with the next cycle, so the current one
+			// is not cut short and the camera triggers keep their spacing
+			if (freqChange_request)
+				handleFreqChange();
+			if (staged_fields != 0)
+				commitStagedConfiguration();
+			// in encoder mode the lights keep strobing until the encoder triggers the next image
+			camera_cycle = (config.encoder_counts_per_image == 0) || config.external_trigger_mode;
+			compileCycle();
 		}
-
-	} else {
-		if (now_us - next_nir_trigger_end_time < config.full_cycle_len_us) {
-			if (power_on) {
-				digitalWriteFast(PIN_NIR_TRIGGER_IN, LOW);// turn the NIR trigger off
-
-			}
-
-			if (nth_stripe < nir_trigger_factor - 1) {
-				nth_stripe++;
-				nir_trigger_state = false;
-				computeNirTriggerStartTime();
-			}
-
+		// check after the last pulse if image has been taken at some time
+		if ((nth_strobe == cycleStrobes()-1) && power_on ) {
+			handleCameraStrobeLatch();
 		}
+		pulse_state = false;
 	}
-#endif // DO_NIR_TRIGGER
+
+	handleCameraStrobeEdges();
 
   	wdt_reset();
 
@@ -1318,7 +2804,7 @@ void loop() {
 		input_power_on = false;
 #ifdef DEBUG
 		if (debugging_mode) {
-			Serial.print('+');
+			serial_out.print('+');
 		}
 #endif
 	}
@@ -1329,21 +2815,12 @@ void loop() {
 		setDaisyChainOutput (DAISY_INPUT_POWER_OFF);
 #ifdef DEBUG
 		if (debugging_mode) {
-			Serial.print('0');
+			serial_out.print('0');
 		}
 #endif
 	}
 
 
-	// turn off the camera trigger in the second pulse, no relevance for timing
-    if (image_capture_turned_on) {
-		if (power_on && (now_us - next_camera_off_time < config.full_cycle_len_us)) {
-			digitalWriteFast(PIN_CAMERA_TRIGGER_IN,  LOW);
-		}
-	}
-
-
-
 	// *** Auto calibration mode ***
 	// take the exposure time and compute strobing frequency
 	// Do this right after lights turned on to avoid flickering
@@ -1357,71 +2834,61 @@ void loop() {
 				unsigned long new_lights_pulse_duty_len_us = camera_exposure_avr_us + LIGHTS_PULSE_ON_DELAY - LIGHTS_PULSE_OFF_DELAY;
 
 				new_lights_pulse_duty_len_us = constrain(new_lights_pulse_duty_len_us, MIN_DUTY_LEN_US, MAX_DUTY_LEN_US);
-				unsigned long new_lights_pulse_len_us = MAX_DUTY_RATIO * new_lights_pulse_duty_len_us ;
 #ifdef DEBUG
 				if (debugging_mode) {
-					Serial.println();
-					Serial.print("calibration:");
-					Serial.print(camera_exposure_avr_deriv_us);
-					Serial.print(",");
-					Serial.print(camera_exposure_last_avr_us);
-					Serial.print(",");
-					Serial.print(camera_exposure_avr_us);
-					Serial.print(",");
-					Serial.print(new_lights_pulse_len_us);
-					Serial.print(",");
-					Serial.print(new_lights_pulse_duty_len_us);
-					Serial.println(")");
+					serial_out.println();
+					serial_out.print("calibration:");
+					serial_out.print(camera_exposure_avr_deriv_us);
+					serial_out.print(",");
+					serial_out.print(camera_exposure_last_avr_us);
+					serial_out.print(",");
+					serial_out.print(camera_exposure_avr_us);
+					serial_out.print(",");
+					serial_out.print(MAX_DUTY_RATIO * new_lights_pulse_duty_len_us);
+					serial_out.print(",");
+					serial_out.print(new_lights_pulse_duty_len_us);
+					serial_out.println(")");
 				}
 #endif
 				camera_exposure_last_avr_us = camera_exposure_avr_us;
-				config.lights_pulse_len_us = new_lights_pulse_len_us;
-				config.light_pulse_duty_len_us = new_lights_pulse_duty_len_us;
-				config.no_of_strobes = config.full_cycle_len_us/config.lights_pulse_len_us;	// compute the number of strobes per cycle and convert to int
-				config.lights_pulse_len_us = config.full_cycle_len_us/config.no_of_strobes; // now adapt the pulse cycle length to get an equal distribution of pulses
-				config.light_pulse_duty_len_us = config.full_cycle_len_us / MAX_DUTY_RATIO;
-
-
-				computeCycleLengths();
-#ifdef DO_NIR_TRIGGER
-				computeNirCycleLengths();
-#endif //DO_NIR_TRIGGER
-				start_cycle_time_us = now_us + config.lights_pulse_len_us - input_light_pulse_duty_len_us;
-
-				computePulseStartTime();
-
-#ifdef DO_NIR_TRIGGER
-				computeNirTriggerStartTime();
-#endif //DO_NIR_TRIGGER
+				// applied like the l command at the end of this cycle
+				input_light_pulse_duty_len_us = new_lights_pulse_duty_len_us;
+				freqChange_request = true;
 			}
 		}
 	}
 
-	// after the pulse we have 5-9ms time for some paperwork
-	if (pulse_turned_off || freqChange_request) {
-		// check after the last pulse if image has been taken at some time
-		if ((nth_strobe == config.no_of_strobes-1) && power_on ) {
-				handleCameraStrobeLatch();
-		}
+	// *** paperwork in the slack until the next event of the timeline ***
+	if (markers == MARKER_NONE)
+		scheduler.dispatch(ticksToUs(timeline.slackTicks(timebase.ticks())));
 
-		// do one of the following tasks in their order of priority
+	// keep the queue of the timeline filled
+	timeline.feed();
+#ifdef DO_HW_PULSE_ENGINE
+	if (!cycle_restart_requested)
+		pulse_engine.service();
+#endif
+}
 
-		// Check to see if IN0 has been triggered. This will happened in daisy chain or external trigger mode
-		pollIN0InterruptEvent();
+// *** Accept new input from UI at the cycle boundary ***
+// called right before the next cycle is compiled, the schedule of the current cycle stays as it is
+void handleFreqChange()
+{
+	freqChange_request = false;
+	bool from_leader = freqChange_from_leader;
+	freqChange_from_leader = false;
 
-	// *** Accept new input from UI in the second cycle, right after lights turned off  ***
-    //Checks for FPS change
-    bool fps_not_zero = (input_full_cycle_len_us != 0);
-    bool fps_has_changed = (input_full_cycle_len_us != config.full_cycle_len_us);
+	//Checks for FPS change
+	bool fps_not_zero = (input_full_cycle_len_us != 0);
+	bool fps_has_changed = (input_full_cycle_len_us != config.full_cycle_len_us);
 
-    //Checks for light pulse on time change (i.e. exposure time changed)
-    bool light_pulse_not_zero = (input_light_pulse_duty_len_us != 0);
-    bool light_pulse_has_changed = (input_light_pulse_duty_len_us != config.light_pulse_duty_len_us);
+	//Checks for light pulse on time change (i.e. exposure time changed)
+	bool light_pulse_not_zero = (input_light_pulse_duty_len_us != 0);
+	bool light_pulse_has_changed = (input_light_pulse_duty_len_us != config.light_pulse_duty_len_us);
 
-    bool not_external_trigger_mode = (!config.external_trigger_mode);
+	bool not_external_trigger_mode = (!config.external_trigger_mode);
 
 	if(( ((fps_not_zero && fps_has_changed) || (light_pulse_not_zero && light_pulse_has_changed)) && not_external_trigger_mode )) {
-		freqChange_request = false;
 		if (input_full_cycle_len_us != 0) {
 			config.full_cycle_len_us = input_full_cycle_len_us;
 		}
@@ -1433,38 +2900,70 @@ void loop() {
 
 		input_full_cycle_len_us = 0;
 		input_light_pulse_duty_len_us = 0;
-		nth_strobe=0;
 
 		if(!config.external_trigger_mode)
 		{
 			computeCycleLengths();
+			// the sub-triggers that do not fit anymore fall back to their own offset
+			if (config.sub_trigger_interleaved && !placeSubTriggers())
+				printError(ErrorSubTriggerOverlap);
 		}
-#ifdef DO_NIR_TRIGGER
-		nth_stripe=0;
-		computeNirCycleLengths();
-#endif //DO_NIR_TRIGGER
-		start_cycle_time_us = now_us + config.lights_pulse_len_us;
-		computePulseStartTime();
-
-#ifdef DO_NIR_TRIGGER
-		computeNirTriggerStartTime();
-#endif //DO_NIR_TRIGGER
-
-		daisyChainFindCameraFreq(config.full_cycle_len_us);
-		delayedWriteConfiguration(); // does not actually write but triggers a successive writing process
-	} else if (trigger_return_configuration) { // *** return the status string ***
-		returnConfiguration();
-		trigger_return_configuration = false;
-	} else { // *** write stuff to EEPROM ***
-		// write stuff to EEPROM in the second pulse, so more than one pulse would be nice
-		// write one byte to EEPROM if there is something to write. By this, we do not affect
-		// the main loop while writing since we only have approx 10m in a pulse break to do this
-		updateEPPROMWrite();
-		}
+
+		// the period of the leader changes all the time, it is not stored
+		if (!from_leader || light_pulse_not_zero)
+			delayedWriteConfiguration(); // does not actually write but triggers a successive writing process
 	}
 }
 
-void handleFreqChange()
-{
-
+// budgets of the paperwork tasks, i.e. their worst case execution time
+#define TASK_BUDGET_IN0_EVENT_US 300			// [us] daisy chain frequency tracking
+#define TASK_BUDGET_DAISY_FRAME_RX_US 300		// [us] take over the leader's configuration
+#define TASK_BUDGET_DAISY_CALIBRATION_US (DAISY_CHAIN_ECHO_SETTLE_US+DAISY_CHAIN_ECHO_TIMEOUT_US+100)	// [us] one echo
+#define TASK_BUDGET_DAISY_FRAME_TX_US (DAISY_FRAME_BYTE_US+100)	// [us] one byte of the frame, blocking with delayMicroseconds()
+#define TASK_BUDGET_RETURN_CONFIG_US 800		// [us] status string, fits into the serial buffer
+#define TASK_BUDGET_RETURN_CHAIN_STATUS_US 800	// [us] status string, fits into the serial buffer
+#define TASK_BUDGET_SERIAL_COMMAND_US (SERIAL_COMMAND_READ_US+1000)	// [us] characters of a command and the command
+#define TASK_BUDGET_SERIAL_OUT_US 400			// [us] fill the transmit buffer of the UART
+#define TASK_BUDGET_HELP_SECTION_US 800			// [us] one section of the help page
+#define TASK_BUDGET_TELEMETRY_US 300			// [us] one telemetry frame into the serial output
+#define TASK_BUDGET_EEPROM_WRITE_US 100			// [us] starts one byte, the EEPROM takes 3.3ms to program it
+
+bool in0EventReady() { return has_cycle_start_triggered; }
+bool daisyFrameRxReady() { return daisy_frame_receiver.available(); }
+bool daisyFrameTxReady() { return daisy_frame_next_byte >= 0; }
+bool daisyCalibrationReady() { return daisy_chain_calibration_samples > 0; }
+bool serialOutReady() { return !serial_out.empty() && (Serial.availableForWrite() > 0); }
+bool returnConfigurationReady() { return trigger_return_configuration && (serial_out.room() >= REPORT_SECTION_LEN); }
+bool returnChainStatusReady() { return trigger_return_chain_status && (serial_out.room() >= REPORT_SECTION_LEN); }
+bool helpSectionReady() { return (help_part >= 0) && (serial_out.room() >= REPORT_SECTION_LEN); }
+bool telemetryReady() { return telemetry_pending && (serial_out.room() >= TELEMETRY_FRAME_LEN); }
+bool serialCommandReady() { return command_pending || (Serial.available() > 0); }
+bool eepromWriteReady() { return ((current_config_byte_to_write >= 0) || (current_master_byte_to_write >= 0)) && eeprom_is_ready(); }
+
+void runReturnConfiguration() {
+	returnConfiguration();
+	trigger_return_configuration = false;
+}
+void runReturnChainStatus() {
+	returnChainStatus();
+	trigger_return_chain_status = false;
+}
+void runSerialCommand() { execute_serial_command(); }
+void runSerialOut() { serial_out.pump(); }
+void runEEPROMWrite() { updateEPPROMWrite(); }
+
+// tasks in their order of priority
+void setupScheduler() {
+	scheduler.setup(delayedMicros);
+	scheduler.addTask(F("IN0 event"), in0EventReady, pollIN0InterruptEvent, TASK_BUDGET_IN0_EVENT_US);
+	scheduler.addTask(F("daisy frame rx"), daisyFrameRxReady, receiveDaisyChainFrame, TASK_BUDGET_DAISY_FRAME_RX_US);
+	scheduler.addTask(F("daisy frame tx"), daisyFrameTxReady, sendDaisyChainFrameByte, TASK_BUDGET_DAISY_FRAME_TX_US);
+	scheduler.addTask(F("daisy calibration"), daisyCalibrationReady, runDaisyChainCalibration, TASK_BUDGET_DAISY_CALIBRATION_US);
+	scheduler.addTask(F("serial out"), serialOutReady, runSerialOut, TASK_BUDGET_SERIAL_OUT_US);
+	scheduler.addTask(F("telemetry"), telemetryReady, sendTelemetry, TASK_BUDGET_TELEMETRY_US);
+	scheduler.addTask(F("return config"), returnConfigurationReady, runReturnConfiguration, TASK_BUDGET_RETURN_CONFIG_US);
+	scheduler.addTask(F("return chain"), returnChainStatusReady, runReturnChainStatus, TASK_BUDGET_RETURN_CHAIN_STATUS_US);
+	scheduler.addTask(F("help page"), helpSectionReady, printHelpSection, TASK_BUDGET_HELP_SECTION_US);
+	scheduler.addTask(F("serial command"), serialCommandReady, runSerialCommand, TASK_BUDGET_SERIAL_COMMAND_US);
+	scheduler.addTask(F("EEPROM write"), eepromWriteReady, runEEPROMWrite, TASK_BUDGET_EEPROM_WRITE_US);
 }
\ No newline at end of file
@@ -0,0 +1,97 @@
+///*******************************************
+///@file phaseLock.h
+///@brief Software PLL locking the cycle of a daisy chain follower to the cycle of its leader.
+///      Every CYCLE_START of the leader gives the phase, i.e. the time between the leader's
+///      and the own cycle start. A proportional-integral controller turns it into the period
+///      of the own cycle (integral part) and a one-time shift of the next cycle start
+///      (proportional part). Converges within a few cycles, for any period of the leader.
+///      Before it is locked, the follower restarts its cycle with the leader's and the
+///      period is measured between two CYCLE_STARTs.
+///      After a holdover the cycle is not restarted, the phase slews back in by at most
+///      max_phase_us per reference with the period kept, then the controller takes over.
+///*******************************************
+
+#ifndef PHASE_LOCK_H
+#define PHASE_LOCK_H
+
+#include <Arduino.h>
+
+class PhaseLock
+{
+	public:
+	PhaseLock() { reset(); }
+
+	/// @brief forget the lock, the next reference restarts the acquisition
+	void reset() {
+		period_us_ = 0;
+		correction_us_ = 0;
+		last_reference_us_ = 0;
+		locked_ = false;
+		slewing_ = false;
+	}
+
+	/// @brief the reference got lost, keep its period. Once it is back, the phase slews in
+	///			instead of losing the lock or restarting the cycle
+	inline void holdover() { slewing_ = true; }
+
+	/// @brief the holdover gave up, the cycle runs on its own until the reference is back
+	inline void unlock() { locked_ = false; }
+
+	/// @brief called with every reference, i.e. CYCLE_START of the leader
+	/// @param reference_us [us] time of the reference
+	/// @param phase_us [us] time of the reference minus the own cycle start nearest to it
+	/// @param max_phase_us [us] larger phases lose the lock
+	void update(unsigned long reference_us, long phase_us, unsigned long max_phase_us) {
+		if (slewing_) {
+			// back from the holdover, like acquiring the lock but without restarting the cycle,
+			// and the period of the leader is still known
+			if ((unsigned long)abs(phase_us) > max_phase_us) {
+				correction_us_ = (phase_us > 0)?(long)max_phase_us:-(long)max_phase_us;
+			} else {
+				correction_us_ = phase_us;
+				slewing_ = false;
+				locked_ = true;
+			}
+		} else if (!locked_) {
+			// the cycle has been restarted with the reference, the phase is 0
+			if (last_reference_us_ != 0) {
+				period_us_ = reference_us - last_reference_us_;
+				locked_ = true;
+			}
+			correction_us_ = 0;
+		} else if ((unsigned long)abs(phase_us) > max_phase_us) {
+			locked_ = false;
+			correction_us_ = 0;
+		} else {
+			// gains Ki = 1/2 and Kp = 3/4
+			period_us_ += phase_us/2;
+			correction_us_ = phase_us - phase_us/4;
+		}
+		last_reference_us_ = reference_us;
+	}
+
+	/// @brief true if the period of the leader is known and the phase is small
+	inline bool locked() const { return locked_; }
+
+	/// @brief true if the cycle follows period() and takeCorrection() instead of restarting with the reference
+	inline bool tracking() const { return locked_ || slewing_; }
+
+	/// @brief [us] period of the leader, valid when locked
+	inline unsigned long period() const { return period_us_; }
+
+	/// @brief [us] shift of the next cycle start, returned only once
+	long takeCorrection() {
+		long correction_us = correction_us_;
+		correction_us_ = 0;
+		return correction_us;
+	}
+
+	private:
+	unsigned long period_us_;			// [us] integral part
+	long correction_us_;				// [us] proportional part
+	unsigned long last_reference_us_;	// [us] 0 if none
+	volatile bool locked_;				// read by the interrupt
+	volatile bool slewing_;				// phase slews in after a holdover, read by the interrupt
+};
+
+#endif // PHASE_LOCK_H
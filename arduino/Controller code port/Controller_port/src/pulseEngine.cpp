@@ -0,0 +1,72 @@
+///*******************************************
+///@file pulseEngine.cpp
+///@brief Outputs the events of the timeline by hardware timer compare interrupts,
+///      so their timing does not depend on how long an iteration of loop() takes.
+///*******************************************
+
+#include <limits.h>
+#include "pulseEngine.h"
+#include "timeline.h"
+#include "timebase.h"
+
+PulseEngine pulse_engine;
+
+PulseEngine::PulseEngine() {
+	armed_ = false;
+}
+
+void PulseEngine::setup() {
+	uint8_t sreg = SREG;
+	cli();
+	TIMSK1 &= ~_BV(OCIE1A);
+	TIFR1 = _BV(OCF1A);
+	armed_ = false;
+	SREG = sreg;
+}
+
+void PulseEngine::service() {
+	uint8_t sreg = SREG;
+	cli();
+	while (!armed_ && timeline.pending()) {
+		unsigned long at_ticks = timeline.nextDueTicks();
+		unsigned long lead_ticks = at_ticks - timebase.ticks();
+		if ((lead_ticks >= ULONG_MAX/2) || (lead_ticks < usToTicks(PULSE_ENGINE_MIN_LEAD_US))) {
+			timeline.fire();
+			continue;
+		}
+		if (lead_ticks > usToTicks(PULSE_ENGINE_HORIZON_US))
+			break;
+
+		// the compare value is given by the lower 16 bits of the time in ticks
+		uint16_t compare = (uint16_t)at_ticks;
+		OCR1A = compare;
+		TIFR1 = _BV(OCF1A);
+		TIMSK1 |= _BV(OCIE1A);
+		armed_ = true;
+		// an interrupt might have delayed us beyond the compare value, then the match is lost
+		if ((int16_t)(compare - TCNT1) <= 0)
+			fire();
+	}
+	SREG = sreg;
+}
+
+void PulseEngine::fire() {
+	TIMSK1 &= ~_BV(OCIE1A);
+	armed_ = false;
+	if (timeline.pending())
+		timeline.fire();
+}
+
+void PulseEngine::cancel() {
+	uint8_t sreg = SREG;
+	cli();
+	TIMSK1 &= ~_BV(OCIE1A);
+	armed_ = false;
+	SREG = sreg;
+}
+
+ISR(TIMER1_COMPA_vect) {
+	pulse_engine.fire();
+	// arm the following event, events closer than the minimum lead go out right now
+	pulse_engine.service();
+}
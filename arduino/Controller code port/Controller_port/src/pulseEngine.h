@@ -0,0 +1,45 @@
+///*******************************************
+///@file pulseEngine.h
+///@brief Outputs the events of the timeline by hardware timer compare interrupts,
+///      so their timing does not depend on how long an iteration of loop() takes.
+///      Timer1 is the time base (see timebase.h), its compare unit A always waits for the
+///      next event of the timeline. The interrupt outputs it and arms the following one,
+///      loop() only does the bookkeeping afterwards.
+///*******************************************
+
+#ifndef PULSE_ENGINE_H
+#define PULSE_ENGINE_H
+
+#include <Arduino.h>
+
+// events further ahead than this are not armed yet, service() tries again later.
+// Must be less than half of the 16 bit timer range (32768us) to compare safely
+constexpr unsigned long PULSE_ENGINE_HORIZON_US = 15000UL;
+// events closer than this are output immediately instead of being armed
+constexpr unsigned long PULSE_ENGINE_MIN_LEAD_US = 8UL;
+
+class PulseEngine
+{
+	public:
+	PulseEngine();
+
+	/// @brief prepare the compare unit, the time base needs to be set up before
+	void setup();
+
+	/// @brief arms the compare unit for the next event of the timeline, if none is armed yet.
+	///			Events already due are output right away. Call after the timeline has been fed.
+	void service();
+
+	/// @brief disarm the compare unit, used whenever the timeline is truncated
+	void cancel();
+
+	/// @brief called from the compare interrupt, outputs the armed event
+	void fire();
+
+	private:
+	volatile bool armed_;
+};
+
+extern PulseEngine pulse_engine;
+
+#endif // PULSE_ENGINE_H
@@ -0,0 +1,97 @@
+///*******************************************
+///@file scheduler.cpp
+///@brief Cooperative scheduler for the paperwork done in the slack between two events
+///      of the timeline.
+///*******************************************
+
+#include "scheduler.h"
+#include "serialOut.h"
+
+Scheduler scheduler;
+
+Scheduler::Scheduler() {
+	no_of_tasks_ = 0;
+	clock_ = micros;
+}
+
+void Scheduler::setup(scheduler_clock_function clock) {
+	clock_ = clock;
+}
+
+bool Scheduler::addTask(const __FlashStringHelper* name, scheduler_ready_function ready,
+						scheduler_run_function run, unsigned long budget_us) {
+	if (no_of_tasks_ >= SCHEDULER_MAX_TASKS)
+		return false;
+
+	scheduler_task& task = tasks_[no_of_tasks_++];
+	task.name = name;
+	task.ready = ready;
+	task.run = run;
+	task.budget_us = budget_us;
+	task.max_us = 0;
+	task.overruns = 0;
+	task.deferred = 0;
+	task.starved = 0;
+	task.waiting = false;
+	return true;
+}
+
+bool Scheduler::dispatch(unsigned long slack_us) {
+	for (uint8_t i = 0; i < no_of_tasks_; i++) {
+		scheduler_task& task = tasks_[i];
+		if (!task.ready()) {
+			task.waiting = false;
+			continue;
+		}
+
+		// a task that does not fit waits, but lower priority tasks might still fit
+		unsigned long start_us = clock_();
+		if (task.budget_us + SCHEDULER_MARGIN_US > slack_us) {
+			task.deferred++;
+			if (!task.waiting) {
+				task.waiting = true;
+				task.waiting_since_us = start_us;
+			} else if (start_us - task.waiting_since_us >= SCHEDULER_STARVATION_US) {
+				// the slack never gets big enough, the budget does not fit the schedule
+				task.starved++;
+				task.waiting_since_us = start_us;
+			}
+			continue;
+		}
+		task.waiting = false;
+
+		task.run();
+		unsigned long duration_us = clock_() - start_us;
+		if (duration_us > task.max_us)
+			task.max_us = duration_us;
+		if (duration_us > task.budget_us)
+			task.overruns++;
+		return true;
+	}
+	return false;
+}
+
+uint16_t Scheduler::overruns() const {
+	uint16_t overruns = 0;
+	for (uint8_t i = 0; i < no_of_tasks_; i++)
+		overruns += tasks_[i].overruns;
+	return overruns;
+}
+
+void Scheduler::printStatistics(uint8_t no) {
+	if (no >= no_of_tasks_)
+		return;
+	scheduler_task& task = tasks_[no];
+	serial_out.print(F("  task "));
+	serial_out.print(task.name);
+	serial_out.print(F(": max="));
+	serial_out.print(task.max_us);
+	serial_out.print(F("[us] budget="));
+	serial_out.print(task.budget_us);
+	serial_out.print(F("[us] overruns="));
+	serial_out.print(task.overruns);
+	serial_out.print(F(" deferred="));
+	serial_out.print(task.deferred);
+	serial_out.print(F(" starved="));
+	serial_out.println(task.starved);
+}
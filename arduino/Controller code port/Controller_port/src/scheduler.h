@@ -0,0 +1,77 @@
+///*******************************************
+///@file scheduler.h
+///@brief Cooperative scheduler for the paperwork done in the slack between two events
+///      of the timeline (serial commands, status, EEPROM writes, ...). Each task has a
+///      budget, its worst case execution time, and is only dispatched if that budget fits
+///      into the time left until the next event. Tasks exceeding their budget are counted
+///      as overruns, tasks waiting for a slack big enough are counted as deferred.
+///      A task is never run beyond the slack, so a budget has to fit the smallest slack of
+///      a normal schedule (2ms between two light pulses at max strobe density). Longer work
+///      is split into pieces, like the EEPROM write that starts one byte per dispatch and
+///      lets the EEPROM program it in the background. A task deferred for more than
+///      SCHEDULER_STARVATION_US is counted as starved, once per SCHEDULER_STARVATION_US.
+///      Tasks mask interrupts only for a few cycles to copy shared variables or to write a
+///      port, which delays the compare interrupt of the pulse engine by a few us at most.
+///*******************************************
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+constexpr uint8_t SCHEDULER_MAX_TASKS = 12;
+constexpr unsigned long SCHEDULER_MARGIN_US = 100UL;	// [us] left to loop() on top of a task's budget
+constexpr unsigned long SCHEDULER_STARVATION_US = 20000UL;	// [us] a task deferred this long is counted as starved
+
+typedef bool (*scheduler_ready_function)();		// true if the task has something to do
+typedef void (*scheduler_run_function)();
+typedef unsigned long (*scheduler_clock_function)();
+
+struct scheduler_task {
+	const __FlashStringHelper* name;
+	scheduler_ready_function ready;
+	scheduler_run_function run;
+	unsigned long budget_us;		// [us] worst case execution time
+	unsigned long max_us;			// [us] longest execution measured
+	uint16_t overruns;				// number of executions exceeding the budget
+	uint16_t deferred;				// number of times the task was ready but the slack was too small
+	uint16_t starved;				// number of times the task was deferred for SCHEDULER_STARVATION_US
+	bool waiting;					// deferred since waiting_since_us
+	unsigned long waiting_since_us;
+};
+
+class Scheduler
+{
+	public:
+	Scheduler();
+
+	/// @brief clock used to measure execution times, needs to be the clock of the timeline
+	void setup(scheduler_clock_function clock);
+
+	/// @brief tasks are dispatched in the order they have been added
+	/// @return false if there is no room for another task
+	bool addTask(const __FlashStringHelper* name, scheduler_ready_function ready,
+				 scheduler_run_function run, unsigned long budget_us);
+
+	/// @brief runs the first ready task whose budget fits into slack_us
+	/// @return true if a task has been run
+	bool dispatch(unsigned long slack_us);
+
+	/// @brief number of overruns of all tasks since start
+	uint16_t overruns() const;
+
+	/// @brief number of tasks added
+	inline uint8_t noOfTasks() const { return no_of_tasks_; }
+
+	/// @brief print execution times of task no to the serial output, a line per task
+	void printStatistics(uint8_t no);
+
+	private:
+	scheduler_task tasks_[SCHEDULER_MAX_TASKS];
+	uint8_t no_of_tasks_;
+	scheduler_clock_function clock_;
+};
+
+extern Scheduler scheduler;
+
+#endif // SCHEDULER_H
@@ -0,0 +1,37 @@
+///*******************************************
+///@file serialOut.cpp
+///@brief Output to the serial interface without blocking loop().
+///*******************************************
+
+#include "serialOut.h"
+
+SerialOut serial_out;
+
+size_t SerialOut::write(uint8_t data) {
+	if (room() == 0) {
+		stalls_++;
+		// same as Serial.write() with a full transmit buffer
+		Serial.write(ring_[tail_ & (SERIAL_OUT_SIZE-1)]);
+		tail_++;
+	}
+	ring_[head_ & (SERIAL_OUT_SIZE-1)] = data;
+	head_++;
+	return 1;
+}
+
+void SerialOut::pump() {
+	int space = Serial.availableForWrite();
+	while ((space > 0) && !empty()) {
+		Serial.write(ring_[tail_ & (SERIAL_OUT_SIZE-1)]);
+		tail_++;
+		space--;
+	}
+}
+
+void SerialOut::flush() {
+	while (!empty()) {
+		Serial.write(ring_[tail_ & (SERIAL_OUT_SIZE-1)]);
+		tail_++;
+	}
+	Serial.flush();
+}
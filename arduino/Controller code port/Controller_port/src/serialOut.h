@@ -0,0 +1,49 @@
+///*******************************************
+///@file serialOut.h
+///@brief Output to the serial interface without blocking loop(). Everything printed goes into
+///      a ring first, pump() moves as much of it to the UART as fits into the UART's transmit
+///      buffer, so Serial.print() never waits for the UART. Only if the ring is full, printing
+///      waits for the UART like Serial does, which is counted as a stall. Long reports are
+///      printed section by section, each once room() is big enough.
+///*******************************************
+
+#ifndef SERIAL_OUT_H
+#define SERIAL_OUT_H
+
+#include <Arduino.h>
+
+constexpr uint8_t SERIAL_OUT_SIZE = 128;		// must be a power of 2
+
+class SerialOut : public Print
+{
+	public:
+	SerialOut() { head_ = 0; tail_ = 0; stalls_ = 0; }
+
+	/// @brief queues one byte, waits for the UART only if the ring is full
+	virtual size_t write(uint8_t data);
+	using Print::write;
+
+	/// @brief moves the queued bytes that fit into the UART's transmit buffer, does not block
+	void pump();
+
+	/// @brief waits until everything queued has been sent
+	virtual void flush();
+
+	inline bool empty() const { return head_ == tail_; }
+
+	/// @brief bytes that can be queued without waiting
+	inline uint8_t room() const { return SERIAL_OUT_SIZE - (uint8_t)(head_ - tail_); }
+
+	/// @brief number of writes that had to wait for the UART since start
+	inline uint16_t stalls() const { return stalls_; }
+
+	private:
+	uint8_t ring_[SERIAL_OUT_SIZE];
+	uint8_t head_;
+	uint8_t tail_;
+	uint16_t stalls_;
+};
+
+extern SerialOut serial_out;
+
+#endif // SERIAL_OUT_H
@@ -0,0 +1,35 @@
+///*******************************************
+///@file timebase.cpp
+///@brief 32 bit time base with 0.5us per tick.
+///*******************************************
+
+#include "timebase.h"
+
+Timebase timebase;
+
+volatile unsigned long timebase_overflows = 0;
+
+Timebase::Timebase() {
+}
+
+void Timebase::setup() {
+	uint8_t sreg = SREG;
+	cli();
+	// normal mode, no output compare pins, clk/8 gives 0.5us per tick
+	TCCR1A = 0;
+	TCCR1B = _BV(CS11);
+	TCNT1 = 0;
+#ifdef DEBUG
+	// start very close to the end of a long to simulate an overflow of the us after 20 seconds
+	timebase_overflows = (0xFFFFFFFFUL - 20*1000000UL) >> 15;
+#else
+	timebase_overflows = 0;
+#endif
+	TIFR1 = _BV(TOV1);
+	TIMSK1 = _BV(TOIE1);
+	SREG = sreg;
+}
+
+ISR(TIMER1_OVF_vect) {
+	timebase_overflows++;
+}
@@ -0,0 +1,71 @@
+///*******************************************
+///@file timebase.h
+///@brief 32 bit time base with 0.5us per tick, used by all schedule math instead of micros().
+///      Timer1 runs free with clk/8 and is extended to 32 bit by its overflow interrupt.
+///      Reading it is inline and takes a few cycles, and unlike micros() it has a resolution
+///      of 0.5us instead of 4us.
+///      Times in ticks wrap every 35 minutes, times in us every 71 minutes. Both are
+///      compared with modulo math. A time in us can be converted to ticks, but not the
+///      other way round (the upper bit is lost), durations can be converted both ways.
+///*******************************************
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <Arduino.h>
+
+constexpr unsigned long TIMEBASE_TICKS_PER_US = 2;
+
+constexpr unsigned long usToTicks(unsigned long us) { return us * TIMEBASE_TICKS_PER_US; }
+constexpr unsigned long ticksToUs(unsigned long ticks) { return ticks / TIMEBASE_TICKS_PER_US; }
+
+extern volatile unsigned long timebase_overflows;	// high part of the time base, incremented every 65536 ticks
+
+class Timebase
+{
+	public:
+	Timebase();
+
+	/// @brief take over Timer1 and start the time base
+	void setup();
+
+	/// @brief [ticks] current time, 0.5us per tick
+	inline unsigned long ticks() {
+		unsigned long overflows;
+		uint16_t count;
+		read(overflows, count);
+		return (overflows << 16) | count;
+	}
+
+	/// @brief [us] current time, replaces micros()
+	inline unsigned long micros() {
+		unsigned long overflows;
+		uint16_t count;
+		read(overflows, count);
+		return (overflows << 15) + (count >> 1);
+	}
+
+	/// @brief [us] time of at_ticks, which is in the past, as micros() returned it then
+	inline unsigned long microsAt(unsigned long at_ticks) {
+		unsigned long overflows;
+		uint16_t count;
+		read(overflows, count);
+		return (overflows << 15) + (count >> 1) - ticksToUs(((overflows << 16) | count) - at_ticks);
+	}
+
+	private:
+	inline void read(unsigned long& overflows, uint16_t& count) {
+		uint8_t sreg = SREG;
+		cli();
+		overflows = timebase_overflows;
+		count = TCNT1;
+		// overflow happened but its interrupt has not been served yet
+		if ((TIFR1 & _BV(TOV1)) && (count < 0x8000))
+			overflows++;
+		SREG = sreg;
+	}
+};
+
+extern Timebase timebase;
+
+#endif // TIMEBASE_H
@@ -0,0 +1,245 @@
+///*******************************************
+///@file timeline.cpp
+///@brief Precompiled schedule of all outputs (lights, camera, sub-triggers and daisy chain).
+///*******************************************
+
+#include "timeline.h"
+#include "gpPins.h"
+#include "digitalWriteFast.h"
+
+Timeline timeline;
+
+#define TIMELINE_QUEUE_MASK (TIMELINE_QUEUE_SIZE-1)
+
+// default pins of the outputs, in the order of the bits of TimelineOutput
+static const uint8_t output_pins[TIMELINE_OUTPUTS] = {
+	PIN_LIGHTING_PNP,
+	PIN_CAMERA_TRIGGER_IN,
+#ifdef PIN_NIR_TRIGGER_IN
+	PIN_NIR_TRIGGER_IN,
+#else
+	TIMELINE_NO_PIN,
+#endif
+	PIN_DAISY_OUT0,
+	PIN_DAISY_OUT1,
+	PIN_DAISY_OUT2,
+	TIMELINE_NO_PIN,
+	TIMELINE_NO_PIN
+};
+
+Timeline::Timeline() {
+	next_ = 0;
+	tail_ = 0;
+	handled_ = 0;
+	enabled_ = false;
+	for (uint8_t i = 0; i < TIMELINE_MAX_TRAINS; i++)
+		trains_[i].remaining = 0;
+
+	// group the outputs by their port
+	no_of_ports_ = 0;
+	for (uint8_t p = 0; p < TIMELINE_MAX_PORTS; p++) {
+		ports_[p] = NULL;
+		disabled_clear_[p] = 0;
+	}
+	for (uint8_t i = 0; i < TIMELINE_OUTPUTS; i++) {
+		pins_[i] = TIMELINE_NO_PIN;
+		output_port_[i] = 0;
+		output_mask_[i] = 0;
+		setPin((TimelineOutput)(1 << i), output_pins[i]);
+	}
+}
+
+bool Timeline::setPin(TimelineOutput output, uint8_t pin) {
+	uint8_t i = 0;
+	while ((i < TIMELINE_OUTPUTS) && (output != (1 << i)))
+		i++;
+	if (i == TIMELINE_OUTPUTS)
+		return false;
+
+	uint8_t p = 0;
+	uint8_t mask = 0;
+	if (pin != TIMELINE_NO_PIN) {
+		volatile uint8_t* port = portOutputRegisterFast(pin);
+		while ((p < no_of_ports_) && (ports_[p] != port))
+			p++;
+		if (p == TIMELINE_MAX_PORTS)
+			return false;
+		if (p == no_of_ports_) {
+			ports_[p] = port;
+			no_of_ports_++;
+		}
+		mask = digitalPinToBitMaskFast(pin);
+	}
+
+	uint8_t sreg = SREG;
+	cli();
+	disabled_clear_[output_port_[i]] &= ~output_mask_[i];
+	pins_[i] = pin;
+	output_port_[i] = p;
+	output_mask_[i] = mask;
+	if (output & (OUTPUT_LIGHTS | OUTPUT_CAMERA | OUTPUT_SUB0 | OUTPUT_SUB1 | OUTPUT_SUB2))
+		disabled_clear_[p] |= mask;
+	SREG = sreg;
+	return true;
+}
+
+bool Timeline::addTrain(unsigned long first_ticks, unsigned long period_ticks, uint16_t count,
+						uint8_t outputs, uint8_t levels, uint8_t markers) {
+	return addTrain(first_ticks, period_ticks, 0, 1, count, outputs, levels, markers);
+}
+
+bool Timeline::addSpreadTrain(unsigned long first_ticks, unsigned long span_ticks, uint16_t count,
+							  uint8_t outputs, uint8_t levels, uint8_t markers) {
+	if (count == 0)
+		return true;
+	return addTrain(first_ticks, span_ticks / count, span_ticks % count, count, count, outputs, levels, markers);
+}
+
+bool Timeline::addTrain(unsigned long first_ticks, unsigned long period_ticks, uint16_t remainder, uint16_t divisor,
+						uint16_t count, uint8_t outputs, uint8_t levels, uint8_t markers) {
+	for (uint8_t i = 0; i < TIMELINE_MAX_TRAINS; i++) {
+		timeline_train& train = trains_[i];
+		if (train.remaining == 0) {
+			train.next_ticks = first_ticks;
+			train.period_ticks = period_ticks;
+			train.remainder = remainder;
+			train.divisor = divisor;
+			train.error = 0;
+			train.outputs = outputs;
+			train.levels = levels;
+			train.markers = markers;
+			train.remaining = count;
+			return true;
+		}
+	}
+	return false;
+}
+
+void Timeline::clear() {
+	uint8_t sreg = SREG;
+	cli();
+	for (uint8_t i = 0; i < TIMELINE_MAX_TRAINS; i++)
+		trains_[i].remaining = 0;
+	tail_ = next_;
+	// markers of events already output belong to the dropped schedule as well
+	handled_ = next_;
+	SREG = sreg;
+}
+
+timeline_train* Timeline::earliestTrain() {
+	// on equal times the train added first goes first
+	timeline_train* earliest = NULL;
+	for (uint8_t i = 0; i < TIMELINE_MAX_TRAINS; i++) {
+		timeline_train& train = trains_[i];
+		if ((train.remaining > 0) && ((earliest == NULL) || ((long)(train.next_ticks - earliest->next_ticks) < 0)))
+			earliest = &train;
+	}
+	return earliest;
+}
+
+void Timeline::feed() {
+	while ((uint8_t)(tail_ - handled_) < TIMELINE_QUEUE_SIZE) {
+		timeline_train* train = earliestTrain();
+		if (train == NULL)
+			return;
+
+		// collect the edges of all trains due at the same time, a later train overrides an earlier one
+		timeline_event event;
+		event.at_ticks = train->next_ticks;
+		for (uint8_t p = 0; p < TIMELINE_MAX_PORTS; p++) {
+			event.set[p] = 0;
+			event.clear[p] = 0;
+		}
+		event.markers = MARKER_NONE;
+		do {
+			for (uint8_t i = 0; i < TIMELINE_OUTPUTS; i++) {
+				if (train->outputs & (1 << i)) {
+					uint8_t p = output_port_[i];
+					uint8_t mask = output_mask_[i];
+					if (train->levels & (1 << i)) {
+						event.set[p] |= mask;
+						event.clear[p] &= ~mask;
+					} else {
+						event.clear[p] |= mask;
+						event.set[p] &= ~mask;
+					}
+				}
+			}
+			event.markers |= train->markers;
+			train->next_ticks += train->period_ticks;
+			train->error += train->remainder;
+			if (train->error >= train->divisor) {
+				train->next_ticks++;
+				train->error -= train->divisor;
+			}
+			train->remaining--;
+			train = earliestTrain();
+		} while ((train != NULL) && (train->next_ticks == event.at_ticks));
+
+		volatile timeline_event& queued = queue_[tail_ & TIMELINE_QUEUE_MASK];
+		queued.at_ticks = event.at_ticks;
+		for (uint8_t p = 0; p < TIMELINE_MAX_PORTS; p++) {
+			queued.set[p] = event.set[p];
+			queued.clear[p] = event.clear[p];
+		}
+		queued.markers = event.markers;
+
+		// publish the event to fire() only once it is complete
+		tail_++;
+	}
+}
+
+unsigned long Timeline::slackTicks(unsigned long now_ticks) const {
+	if (!pending())
+		return ULONG_MAX;
+	unsigned long lead_ticks = nextDueTicks() - now_ticks;
+	if (lead_ticks >= ULONG_MAX/2)
+		return 0;
+
+	// the events of the trains are only output once feed() queued them, like dense sub-triggers
+	for (uint8_t i = 0; i < TIMELINE_MAX_TRAINS; i++) {
+		if (trains_[i].remaining > 0) {
+			unsigned long dry_ticks = queue_[(tail_ - 1) & TIMELINE_QUEUE_MASK].at_ticks - usToTicks(TIMELINE_REFILL_US) - now_ticks;
+			if (dry_ticks >= ULONG_MAX/2)
+				return 0;
+			return min(lead_ticks, dry_ticks);
+		}
+	}
+	return lead_ticks;
+}
+
+uint8_t Timeline::handleNext(unsigned long& fired_ticks) {
+	while (handled_ != next_) {
+		volatile timeline_event& event = queue_[handled_ & TIMELINE_QUEUE_MASK];
+		handled_++;
+		if (event.markers != MARKER_NONE) {
+			fired_ticks = event.at_ticks + event.late_ticks;
+			return event.markers;
+		}
+	}
+	return MARKER_NONE;
+}
+
+void Timeline::fire() {
+	volatile timeline_event& event = queue_[next_ & TIMELINE_QUEUE_MASK];
+	// other interrupts might write the same ports
+	uint8_t sreg = SREG;
+	cli();
+	for (uint8_t p = 0; p < TIMELINE_MAX_PORTS; p++) {
+		uint8_t set = event.set[p];
+		uint8_t clear = event.clear[p];
+		if (!enabled_) {
+			set = 0;
+			clear &= disabled_clear_[p];
+		}
+		if (set | clear) {
+			volatile uint8_t* port = ports_[p];
+			*port = (*port & ~clear) | set;
+		}
+	}
+	// events closer than the lead of the pulse engine go out a bit early
+	long late_ticks = timebase.ticks() - event.at_ticks;
+	event.late_ticks = constrain(late_ticks, (long)INT16_MIN, (long)INT16_MAX);
+	SREG = sreg;
+	next_++;
+}
@@ -0,0 +1,144 @@
+///*******************************************
+///@file timeline.h
+///@brief Precompiled schedule of all outputs (lights, camera, sub-triggers and daisy chain).
+///      When a cycle starts, its edges are compiled into trains of equidistant events.
+///      feed() merges the trains into a small queue of events sorted by time, so the
+///      hot path is a single "next event due?" comparison plus writing the outputs.
+///      All times are in ticks of the time base (0.5us, see timebase.h).
+///*******************************************
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <Arduino.h>
+#include <limits.h>
+#include "timebase.h"
+
+constexpr uint8_t TIMELINE_QUEUE_SIZE = 16;		// events compiled ahead, must be a power of 2
+constexpr uint8_t TIMELINE_MAX_TRAINS = 22;		// trains of the current and the ending cycle, see CYCLE_MAX_TRAINS
+constexpr uint8_t TIMELINE_OUTPUTS = 8;			// number of bits in TimelineOutput
+constexpr uint8_t TIMELINE_NO_PIN = 0xFF;		// output is not connected
+constexpr uint8_t TIMELINE_MAX_PORTS = 3;		// output ports the pins of the timeline are spread over
+constexpr unsigned long TIMELINE_REFILL_US = 50;	// [us] left to loop() to feed the queue before it runs dry
+
+// outputs driven by the timeline, an event can touch several of them
+enum TimelineOutput : uint8_t {
+	OUTPUT_LIGHTS = 0x01,			// PIN_LIGHTING_PNP
+	OUTPUT_CAMERA = 0x02,			// PIN_CAMERA_TRIGGER_IN
+	OUTPUT_SUB0 = 0x04,				// sub-trigger channel 0, PIN_NIR_TRIGGER_IN by default
+	OUTPUT_DAISY0 = 0x08,			// PIN_DAISY_OUT0, clock of the daisy chain
+	OUTPUT_DAISY1 = 0x10,			// PIN_DAISY_OUT1
+	OUTPUT_DAISY2 = 0x20,			// PIN_DAISY_OUT2
+	OUTPUT_SUB1 = 0x40,				// sub-trigger channel 1, not connected by default
+	OUTPUT_SUB2 = 0x80				// sub-trigger channel 2, not connected by default
+};
+
+// markers tell loop() which bookkeeping an event requires once it has been output
+enum TimelineMarker : uint8_t {
+	MARKER_NONE = 0,
+	MARKER_PULSE_ON = 0x01,			// lights went on
+	MARKER_PULSE_OFF = 0x02,		// lights went off
+	MARKER_CAMERA_ON = 0x04			// camera has been triggered
+};
+
+// all edges due at the same time, as one read-modify-write per output port
+struct timeline_event {
+	unsigned long at_ticks;		// [ticks] time the event is due
+	uint8_t set[TIMELINE_MAX_PORTS];	// pins of the port to go HIGH
+	uint8_t clear[TIMELINE_MAX_PORTS];	// pins of the port to go LOW
+	uint8_t markers;				// bookkeeping to be done in loop()
+	int16_t late_ticks;				// [ticks] the event has actually been output this late, set by fire()
+};
+
+// equidistant events with the same outputs, e.g. all light pulses of a cycle.
+// A period that is not a whole number of us is spread Bresenham-style: the distance
+// between two events is period_ticks or period_ticks+1, and the n-th event is never off by more than 1 tick
+struct timeline_train {
+	unsigned long next_ticks;		// [ticks] time of the next event of this train
+	unsigned long period_ticks;	// [ticks] distance between two events, rounded down
+	uint16_t remainder;				// period is period_ticks + remainder/divisor
+	uint16_t divisor;
+	uint16_t error;					// accumulated remainder, always less than divisor
+	uint16_t remaining;				// number of events still to come, 0 if the train is unused
+	uint8_t outputs;
+	uint8_t levels;
+	uint8_t markers;
+};
+
+class Timeline
+{
+	public:
+	Timeline();
+
+	/// @brief add count events starting at first_ticks every period_ticks
+	/// @return false if there is no free train
+	bool addTrain(unsigned long first_ticks, unsigned long period_ticks, uint16_t count,
+				  uint8_t outputs, uint8_t levels, uint8_t markers = MARKER_NONE);
+
+	/// @brief add count events starting at first_ticks every period_ticks + remainder/divisor ticks
+	/// @return false if there is no free train
+	bool addTrain(unsigned long first_ticks, unsigned long period_ticks, uint16_t remainder, uint16_t divisor,
+				  uint16_t count, uint8_t outputs, uint8_t levels, uint8_t markers = MARKER_NONE);
+
+	/// @brief add count events starting at first_ticks, spread evenly over span_ticks.
+	///			The n-th event is at first_ticks + n*span_ticks/count, rounded down
+	/// @return false if there is no free train
+	bool addSpreadTrain(unsigned long first_ticks, unsigned long span_ticks, uint16_t count,
+						uint8_t outputs, uint8_t levels, uint8_t markers = MARKER_NONE);
+
+	/// @brief connect an output to another pin, TIMELINE_NO_PIN disconnects it. The old pin stays
+	///			an output and goes LOW. Events already in the queue still use the old pin
+	/// @return false if the pin is on a port beyond TIMELINE_MAX_PORTS
+	bool setPin(TimelineOutput output, uint8_t pin);
+
+	/// @brief drop all trains and all events not output yet, used when the cycle is restarted.
+	///			The next compiled cycle takes over the outputs from their current state
+	void clear();
+
+	/// @brief move the next events of all trains into the queue, sorted by time. Edges of several
+	///			trains due at the same time are merged into one event. Called by loop()
+	void feed();
+
+	/// @brief while disabled, the schedule keeps running but only edges turning lights, camera
+	///			or sub-triggers off are output, so nothing stays on when the power goes off
+	void enable(bool on) { enabled_ = on; }
+
+	/// @brief returns the markers of the next output event that has some, MARKER_NONE if there is none
+	/// @param fired_ticks [ticks] time that event has actually been output
+	uint8_t handleNext(unsigned long& fired_ticks);
+
+	// hot path, called by loop() or by the interrupt of the pulse engine
+
+	inline bool pending() const { return next_ != tail_; }
+	inline unsigned long nextDueTicks() const { return queue_[next_ & (TIMELINE_QUEUE_SIZE-1)].at_ticks; }
+	///@note modulo math to deal with an overflow of now_ticks
+	inline bool due(unsigned long now_ticks) const { return pending() && (now_ticks - nextDueTicks() < ULONG_MAX/2); }
+	/// @brief [ticks] time left until the next event, 0 if it is overdue, ULONG_MAX if there is none.
+	///			With events still in the trains, it ends TIMELINE_REFILL_US before the queue runs dry
+	unsigned long slackTicks(unsigned long now_ticks) const;
+
+	/// @brief output the next event of the queue
+	void fire();
+
+	private:
+	timeline_train* earliestTrain();
+
+	// port of each output, found by setPin()
+	uint8_t no_of_ports_;
+	uint8_t pins_[TIMELINE_OUTPUTS];
+	volatile uint8_t* ports_[TIMELINE_MAX_PORTS];
+	uint8_t output_port_[TIMELINE_OUTPUTS];		// index into ports_
+	uint8_t output_mask_[TIMELINE_OUTPUTS];		// bit of the output within its port
+	uint8_t disabled_clear_[TIMELINE_MAX_PORTS];	// pins that may go LOW while disabled
+
+	volatile timeline_event queue_[TIMELINE_QUEUE_SIZE];
+	timeline_train trains_[TIMELINE_MAX_TRAINS];
+	volatile uint8_t next_;			// next event to be output, advanced by fire()
+	volatile uint8_t tail_;			// end of the queue, advanced by feed()
+	uint8_t handled_;				// next event whose markers have not been handled yet
+	volatile bool enabled_;
+};
+
+extern Timeline timeline;
+
+#endif // TIMELINE_H